@@ -0,0 +1,26 @@
+#pragma once
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include <string>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ A canvas with the drawing calls of CanvasWrapper that only counts them, for RenderBuffer::replay
+**************************************************************************************************************/
+
+class HeadlessCanvas
+{
+public:
+	HeadlessCanvas() : draws(0), states(0), checksum(0.0f) {}
+
+	uint64_t draws;		// lines, triangles, boxes and strings
+	uint64_t states;	// colors and positions
+	float checksum;		// of what was drawn, so that nothing is optimized away
+
+	void SetColor(char, char, char, char a) { states++; checksum += (unsigned char)a; }
+	void SetPosition(Vector2F position) { states++; checksum += position.X; }
+	void DrawLine(Vector2F start, Vector2F end, float width) { draws++; checksum += end.X - start.X + width; }
+	void FillTriangle(Vector2F p1, Vector2F p2, Vector2F p3, LinearColor color) { draws++; checksum += p1.X + p2.Y + p3.X + color.A; }
+	void FillBox(Vector2F size) { draws++; checksum += size.X; }
+	void DrawString(const std::string& text) { draws++; checksum += (float)text.size(); }
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include "World.h"
+#include <cmath>
+
+
+/*************************************************************************************************************
+ A simulated freeplay for the benchmark
+
+ The ball bounces around the field and the car drives in circles and jumps, stepped at the 120 Hz of
+ the game.
+ The input and the rewind key are scripted by the benchmark. Applying a state moves the simulation to
+ it, as setting the actors does in the game, and every call is counted like BakkesWorld counts its
+ wrapper calls.
+**************************************************************************************************************/
+
+const float HEADLESS_TICK = 1.0f / 120.0f;
+
+class HeadlessWorld : public RewindWorld
+{
+public:
+	ControllerInput input;	// what the car reads, set by the benchmark
+	bool rewindHeld;		// any rewind key
+	bool moving;			// false for the tick of a reset shot
+	bool paused;			// the pause menu is up, step leaves the game as it is
+	bool ballResting;		// the ball lies still on the ground instead of bouncing
+
+	HeadlessWorld(int otherCars) : input(), rewindHeld(false), moving(true), paused(false), ballResting(false), time(0.0f), goalEnabled(true) {
+		state = WorldState();
+		state.rotation[SNAPSHOT_BALL] = QUATERNION_IDENTITY;
+		state.rotation[SNAPSHOT_CAR] = QUATERNION_IDENTITY;
+		state.location[SNAPSHOT_BALL] = Vector(0.0f, 0.0f, 93.0f);
+		state.velocity[SNAPSHOT_BALL] = Vector(700.0f, 1300.0f, 900.0f);
+		state.location[SNAPSHOT_CAR] = Vector(0.0f, -2000.0f, 17.0f);
+		state.boost = 33.0f;
+		state.cars.resize(otherCars);
+		for (int n = 0; n < otherCars; n++) {
+			state.cars[n] = BodyState();
+			state.cars[n].location = Vector(500.0f * n, 2000.0f, 17.0f);
+			state.cars[n].rotation = QUATERNION_IDENTITY;
+		}
+	}
+
+	/* one physics tick of the game */
+	void step() {
+		if (paused) return;
+		time += HEADLESS_TICK;
+		if (ballResting) {
+			state.location[SNAPSHOT_BALL].Z = 93.0f;
+			state.velocity[SNAPSHOT_BALL] = Vector(0.0f, 0.0f, 0.0f);
+		}
+		else bounce(state.location[SNAPSHOT_BALL], state.velocity[SNAPSHOT_BALL]);
+		state.angularVelocity[SNAPSHOT_BALL] = Vector(state.velocity[SNAPSHOT_BALL].Y / 93.0f, -state.velocity[SNAPSHOT_BALL].X / 93.0f, 0.0f);
+		state.rotation[SNAPSHOT_BALL] = spin(state.rotation[SNAPSHOT_BALL], state.angularVelocity[SNAPSHOT_BALL]);
+
+		// a jump every 2 s, a pad picked up every 3 s
+		int second = (int)time;
+		bool jumping = second % 2 == 1 && !state.jump.jumped;
+		state.jump.jumped = second % 2 == 1;
+		state.jump.jumpTime = state.jump.jumped ? time - second : 0.0f;
+
+		// the jump pushes the car up, it then falls back to the ground
+		float climb = jumping ? 292.0f : state.velocity[SNAPSHOT_CAR].Z - 650.0f * HEADLESS_TICK;
+		drive(state.location[SNAPSHOT_CAR], state.velocity[SNAPSHOT_CAR], state.rotation[SNAPSHOT_CAR], input.Throttle, input.Steer);
+		state.location[SNAPSHOT_CAR].Z += climb * HEADLESS_TICK;
+		if (state.location[SNAPSHOT_CAR].Z <= 17.0f) {
+			state.location[SNAPSHOT_CAR].Z = 17.0f;
+			climb = 0.0f;
+		}
+		state.velocity[SNAPSHOT_CAR].Z = climb;
+		state.boost = input.HoldingBoost ? fmaxf(state.boost - 33.3f * HEADLESS_TICK, 0.0f) : state.boost;
+		for (BodyState& car : state.cars)
+			drive(car.location, car.velocity, car.rotation, 1.0f, 0.5f);
+
+		state.pads.known = true;
+		state.pads.picked = (uint64_t)1 << ((second / 3) % PAD_MAX);
+	}
+
+	bool refresh() override { calls.reads += 3; return true; }
+	int otherBodies() override { return (int)(state.balls.size() + state.cars.size()); }
+
+	float secondsElapsed() override { calls.reads++; return time; }
+	bool isCarMoving() override { calls.reads++; return moving; }
+	ControllerInput carInput() override { calls.reads++; return input; }
+	bool isBallInGoal() override { calls.reads += 2; return false; }
+	bool isKeyPressed(int) override { return rewindHeld; }
+	bool isPaused() override { calls.reads++; return paused; }
+
+	/* the simulated game as it stands, for the checks */
+	const WorldState& current() const { return state; }
+
+	void setGoalEnabled(bool enabled) override {
+		if (enabled != goalEnabled) calls.writes++;
+		goalEnabled = enabled;
+	}
+
+	void capture(WorldState& captured) override {
+		calls.reads += 10 + 4 * otherBodies();
+		captured = state;
+	}
+
+	void apply(const WorldState& applied) override {
+		calls.writes += 10 + 4 * otherBodies();
+		state = applied;
+	}
+
+private:
+	static void bounce(Vector& location, Vector& velocity) {
+		const Vector limit(4096.0f - 93.0f, 5120.0f - 93.0f, 2044.0f - 93.0f);
+		velocity.Z -= 650.0f * HEADLESS_TICK;
+		location = location + velocity * HEADLESS_TICK;
+		if (fabsf(location.X) > limit.X) velocity.X = -velocity.X;
+		if (fabsf(location.Y) > limit.Y) velocity.Y = -velocity.Y;
+		if (location.Z < 93.0f || location.Z > limit.Z) velocity.Z = -0.8f * velocity.Z;
+		location.Z = fmaxf(location.Z, 93.0f);
+	}
+
+	static void drive(Vector& location, Vector& velocity, Quaternion& rotation, float throttle, float steer) {
+		float yaw = 2.0f * atan2f(rotation.z, rotation.w) + 2.0f * steer * HEADLESS_TICK;
+		float speed = 1400.0f * throttle;
+		velocity = Vector(speed * cosf(yaw), speed * sinf(yaw), 0.0f);
+		location = location + velocity * HEADLESS_TICK;
+		rotation = Quaternion{ 0.0f, 0.0f, sinf(0.5f * yaw), cosf(0.5f * yaw) };
+	}
+
+	static Quaternion spin(const Quaternion& q, const Vector& w) {
+		float h = 0.5f * HEADLESS_TICK;
+		Quaternion r = {
+			q.x + h * (w.X * q.w + w.Y * q.z - w.Z * q.y),
+			q.y + h * (w.Y * q.w + w.Z * q.x - w.X * q.z),
+			q.z + h * (w.Z * q.w + w.X * q.y - w.Y * q.x),
+			q.w - h * (w.X * q.x + w.Y * q.y + w.Z * q.z)
+		};
+		float n = 1.0f / sqrtf(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+		return Quaternion{ r.x * n, r.y * n, r.z * n, r.w * n };
+	}
+
+	WorldState state;
+	float time;
+	bool goalEnabled;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include "Settings.h"
+#include <sys/resource.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+
+/*************************************************************************************************************
+ What the benchmarks share: the settings at their defaults, a count of heap allocations and the peak
+ memory of the process. Include it from the one source file of a benchmark, it replaces operator new.
+**************************************************************************************************************/
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+/* not inlined, as the calls to operator new are not: inlined, the free would be seen against an operator new
+   and taken for a mismatched pair (-Wmismatched-new-delete) */
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+/* the values the cvars are registered with */
+inline Settings defaultSettings() {
+	Settings settings = Settings();
+	for (const SettingInfo& info : SETTINGS) {
+		switch (info.type) {
+		case SettingType::Bool:		if (info.boolMember) settings.*info.boolMember = atoi(info.defaultValue) != 0; break;
+		case SettingType::Int:		if (info.intMember) settings.*info.intMember = atoi(info.defaultValue); break;
+		case SettingType::Float:	if (info.floatMember) settings.*info.floatMember = (float)atof(info.defaultValue); break;
+		case SettingType::String:	if (info.stringMember) settings.*info.stringMember = info.defaultValue; break;
+		}
+	}
+	for (int e = 0; e < COLOR_ELEMENT_COUNT; e++)
+		settings.colors[e] = COLOR_ELEMENTS[e].defaultValue;
+	return settings;
+}
+
+inline long peakKilobytes() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
@@ -0,0 +1,59 @@
+#include "Measure.h"
+#include "AudioMixer.h"
+#include <chrono>
+#include <cstdio>
+
+
+/*************************************************************************************************************
+ Resampler benchmark
+
+ Runs a looping stereo voice through the resampler as AudioMixer::mix does, for each quality and a few
+ playback speeds, and reports the frames produced per second on one core and the share of that core
+ one voice takes at 44.1 kHz.
+**************************************************************************************************************/
+
+int main() {
+	const size_t FRAMES = 44100;	// a second of noise, padded like a decoded sound
+	DecodedSound sound;
+	sound.frames = FRAMES;
+	sound.sampleRate = MIXER_SAMPLE_RATE;
+	for (std::vector<float>& samples : sound.channels) {
+		samples.resize(FRAMES + 2 * SOUND_PADDING);
+		for (size_t i = 0; i < FRAMES; i++)
+			samples[SOUND_PADDING + i] = (float)(rand() % 2001 - 1000) / 1000.0f;
+	}
+	sound.pad();
+
+	const char* names[RESAMPLER_QUALITY_COUNT] = { "fast, 8 taps", "medium, 16 taps", "high, 32 taps" };
+	const double speeds[] = { 0.5, 1.0, 1.37, 2.0, 3.0 };
+	const int BLOCKS = 4000;	// 40 s of audio
+	float block[MIXER_BLOCK_FRAMES * MIXER_CHANNELS];
+
+	for (int q = 0; q < RESAMPLER_QUALITY_COUNT; q++) {
+		Resampler resampler((ResamplerQuality)q);
+		for (double speed : speeds) {
+			double position = 0.0;
+			float sum = 0.0f;
+			double seconds = 1e9;
+			for (int run = 0; run < 5; run++) {	// the best of five, the machine may be busy
+				auto start = std::chrono::steady_clock::now();
+				for (int b = 0; b < BLOCKS; b++) {
+					const float* filter = resampler.filter(speed);
+					for (int f = 0; f < MIXER_BLOCK_FRAMES; f++) {
+						resampler.sample(filter, sound.channel(0), sound.channel(1), position, block[2 * f], block[2 * f + 1]);
+						position += speed;
+						if (position >= FRAMES) position = fmod(position, (double)FRAMES);
+					}
+					sum += block[b % (MIXER_BLOCK_FRAMES * MIXER_CHANNELS)];
+				}
+				seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			}
+			double perSecond = (double)BLOCKS * MIXER_BLOCK_FRAMES / seconds;
+			printf("%-16s speed %4.2f %7.1f M frames/s %6.3f%% of a core per voice\n", names[q], speed, perSecond / 1e6,
+				100.0 * MIXER_SAMPLE_RATE / perSecond);
+			volatile float mixed = sum;	// keeps the loop
+			(void)mixed;
+		}
+	}
+	return 0;
+}
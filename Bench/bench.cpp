@@ -0,0 +1,111 @@
+#include "HeadlessWorld.h"
+#include "Measure.h"
+#include "RewindEngine.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+
+/*************************************************************************************************************
+ Rewind engine benchmark
+
+ Drives RewindEngine with HeadlessWorld, the settings at their defaults, and reports for each scenario
+ the time per tick, the heap allocations per tick and the peak memory of the process so far. The
+ session file is left off, the capture worker runs as in the game, drained after every tick so its
+ share is counted and none of the captures are dropped.
+**************************************************************************************************************/
+
+Profiler profiler;
+
+class Bench
+{
+public:
+	Bench(int otherCars) : world(otherCars), settings(defaultSettings()) {
+		engine.history.configure((size_t)(settings.rewindMemoryBudget * 1024 * 1024), settings.rewindCompressHistory);
+		engine.recorder.setEnabled(settings.rewindAdaptive);
+		engine.recorder.setTolerance(settings.rewindAdaptiveTolerance);
+		engine.start();
+	}
+
+	~Bench() { engine.close(); }
+
+	/* plays the game with the wheel and the rewind key as given, the key being held when steer is set */
+	void play(int ticks, float steer, bool rewind) {
+		world.rewindHeld = rewind;
+		world.input.Throttle = rewind ? 0.0f : 1.0f;
+		world.input.Steer = steer;
+		for (int n = 0; n < ticks; n++) {
+			world.step();
+			world.refresh();
+			engine.tick(world, settings, 0, 1);
+			engine.pipeline.drain();	// the game leaves the worker 8 ms per tick, a tight loop on one core may not
+		}
+	}
+
+	/* the car stands still for a tick, as after a reset shot */
+	void reset() {
+		world.moving = false;
+		play(1, 0.0f, false);
+		world.moving = true;
+	}
+
+	/* runs a scenario and prints its cost per tick */
+	template <typename Scenario>
+	void measure(const char* name, int ticks, Scenario scenario) {
+		uint64_t before = allocations.load();
+		auto start = std::chrono::steady_clock::now();
+		scenario();
+		engine.pipeline.drain();	// the worker's share of the captures is counted too
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		printf("%-28s %9.0f ns/tick %8.2f allocs/tick %8ld KB peak %7zu snapshots %8zu bytes of history\n", name, ns / ticks,
+			(double)(allocations.load() - before) / ticks, peakKilobytes(), engine.history.size(), engine.history.memoryUsage());
+	}
+
+	RewindEngine engine;
+	HeadlessWorld world;
+	Settings settings;
+};
+
+
+static void run(int otherCars) {
+	printf("freeplay with %d other cars\n", otherCars);
+	Bench bench(otherCars);
+	const int RECORD = 20 * 120;	// 20 s of game
+	const int REWIND = 5 * 120;
+
+	bench.measure("record", RECORD, [&] { bench.play(RECORD, 0.0f, false); });
+
+	bench.world.paused = true;
+	bench.measure("pause menu", REWIND, [&] { bench.play(REWIND, 0.0f, false); });
+	bench.world.paused = false;
+
+	const float steers[] = { 0.3f, 0.6f, 0.9f };
+	for (float steer : steers) {
+		std::string name = "rewind, steer " + std::to_string(steer).substr(0, 3);
+		bench.measure(name.c_str(), REWIND, [&] { bench.play(REWIND, -steer, true); });
+		bench.play(1, 0.0f, false);	// the throttle resumes the shot
+		bench.play(RECORD, 0.0f, false);
+	}
+
+	bench.measure("scrub back and forth", REWIND, [&] {
+		for (int n = 0; n < REWIND / 60; n++)
+			bench.play(60, n % 2 ? 0.9f : -0.9f, true);
+	});
+	bench.play(1, 0.0f, false);
+
+	const int RESETS = 50;
+	bench.measure("record 1 s then reset", RESETS * 121, [&] {
+		for (int n = 0; n < RESETS; n++) {
+			bench.play(120, 0.0f, false);
+			bench.reset();
+		}
+	});
+	printf("\n");
+}
+
+int main() {
+	const int OTHER_CARS[] = { 0, 1, 2, 3, 4, 8 };	// a 1v1 with a bot up to a 4v4, and the 3 of the numbers so far
+	for (int otherCars : OTHER_CARS)
+		run(otherCars);
+	return 0;
+}
@@ -0,0 +1,232 @@
+#include "HeadlessWorld.h"
+#include "BakkesWorld.h"
+#include "Measure.h"
+#include "RewindEngine.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+/*************************************************************************************************************
+ Checks of the engine against HeadlessWorld, and of BakkesWorld over the stand-in wrappers, for what a
+ benchmark cannot show: make check
+
+ Each check prints what it looked at and fails the run (exit code 1) when the engine gets it wrong.
+**************************************************************************************************************/
+
+Profiler profiler;
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+	if (condition) return;
+	printf("  FAILED: %s\n", what);
+	failures++;
+}
+
+/* HeadlessWorld jumps during every odd second */
+static bool jumpedAt(float time) { return (int)time % 2 == 1; }
+static uint64_t padsAt(float time) { return (uint64_t)1 << (((int)time / 3) % PAD_MAX); }
+
+/* the adaptive recorder keeps the snapshot just before a jump with the jump still to do */
+static void checkSideState() {
+	printf("jump and pads of the kept snapshots\n");
+	HeadlessWorld world(0);
+	Settings settings = defaultSettings();
+	RewindEngine engine;
+	engine.history.configure(1024 * 1024, settings.rewindCompressHistory);
+	engine.recorder.setEnabled(true);
+	engine.recorder.setTolerance(settings.rewindAdaptiveTolerance);
+	engine.start();
+
+	world.ballResting = true;
+	world.input.Throttle = 1.0f;	// straight ahead, the car is predictable between the jumps
+	for (int n = 0; n < 10 * 120; n++) {
+		world.step();
+		world.refresh();
+		engine.tick(world, settings, 0, 1);
+		engine.pipeline.drain();	// the game leaves the worker 8 ms per tick, a tight loop may not
+	}
+	engine.recorder.flush(engine.history);
+
+	const SnapshotHistory& history = engine.history;
+	int wrong = 0, brackets = 0;
+	for (size_t i = 0; i < history.size(); i++) {
+		float time = history.timestamp(i);
+		if (history.jumpAt(i).jumped != jumpedAt(time) || history.padsAt(i).picked != padsAt(time)) wrong++;
+		if (i + 1 == history.size() || jumpedAt(time) || !jumpedAt(history.timestamp(i + 1))) continue;
+
+		// i brackets a jump: rewinding to it gives the car its jump back
+		brackets++;
+		engine.overwrite.interpolate(history, i, i, 0.0f, true);
+		engine.replay(world);
+		expect(!world.current().jump.jumped, "the car can jump again at the snapshot before its jump");
+	}
+	printf("  %zu snapshots kept of %lld captured, %d before a jump, %d with the wrong jump or pads\n", history.size(),
+		engine.recorder.capturedCount(), brackets, wrong);
+	expect(brackets == 5, "every jump is bracketed");
+	expect(wrong == 0, "every snapshot has the jump and pads it was captured with");
+	engine.close();
+}
+
+/* a car standing still may still pick up boost or be turned, capture must see it */
+static void checkStillCapture() {
+	printf("capture of a car standing still\n");
+	StandinGame& game = standinGame();
+	game.reset(1, 1);
+	StandinActor& car = game.actors[game.car(0)];
+	car.location = Vector(0.0f, 0.0f, 17.0f);
+	BakkesWorld world(std::make_shared<GameWrapper>(), std::make_shared<CVarManagerWrapper>());
+	WorldState before, after;
+	world.refresh();
+	world.capture(before);
+
+	car.boost = 1.0f;
+	car.rotation = Rotator(0, 16384, 0);
+	game.step(1.0f / 120.0f);
+	world.refresh();
+	world.capture(after);
+	printf("  boost %.2f to %.2f, rotation w %.3f to %.3f\n", before.boost, after.boost, before.rotation[SNAPSHOT_CAR].w,
+		after.rotation[SNAPSHOT_CAR].w);
+	expect(after.boost == 1.0f, "a boost pickup is captured");
+	expect(fabsf(after.rotation[SNAPSHOT_CAR].w - before.rotation[SNAPSHOT_CAR].w) > 0.1f, "a turn is captured");
+}
+
+/* recording into a history attached to a long session only copies the newest records, the ones that fit */
+static void checkDetach(bool compress) {
+	printf("recording after a session of 2^18 records is attached, %s\n", compress ? "compressed" : "uncompressed");
+	const size_t COUNT = 1 << 18;
+	std::vector<SessionRecord> records(COUNT);
+	for (size_t i = 0; i < COUNT; i++) {
+		records[i].frame = SnapshotFrame();
+		records[i].frame.location.v[0] = (float)(i % 4000);
+		records[i].timestamp = i / 120.0f;
+	}
+
+	SnapshotHistory history;
+	history.configure(1024 * 1024, compress);
+	history.attach(records.data(), COUNT);
+	SnapshotFrame frame = records[COUNT - 1].frame;
+	auto start = std::chrono::steady_clock::now();
+	history.push_back(&frame, COUNT / 120.0f, JumpState(), 0);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	size_t size = history.size();
+	printf("  %.2f ms, %zu snapshots kept\n", ms, size);
+	expect(!history.isAttached(), "the history is detached");
+	expect(size > 1000 && size < COUNT, "the budget keeps the newest records");
+	bool newest = true;
+	for (size_t i = 0; i + 1 < size; i++) {
+		size_t record = COUNT - (size - 1) + i;
+		newest = newest && history.timestamp(i) == records[record].timestamp
+			&& fabsf(history.frame(i).location.v[0] - records[record].frame.location.v[0]) < 0.1f;
+	}
+	expect(newest, "the kept snapshots are the newest records, in order");
+}
+
+/* the default budget keeps seconds of history however many cars there are */
+static void checkManyPages(int otherCars) {
+	printf("history at the default budget with %d other cars\n", otherCars);
+	HeadlessWorld world(otherCars);
+	Settings settings = defaultSettings();
+	RewindEngine engine;
+	engine.history.configure((size_t)(settings.rewindMemoryBudget * 1024 * 1024), settings.rewindCompressHistory);
+	engine.recorder.setEnabled(settings.rewindAdaptive);
+	engine.recorder.setTolerance(settings.rewindAdaptiveTolerance);
+	engine.start();
+
+	world.input.Throttle = 1.0f;
+	for (int n = 0; n < 20 * 120; n++) {
+		world.step();
+		world.refresh();
+		engine.tick(world, settings, 0, 1);
+		engine.pipeline.drain();
+	}
+
+	const SnapshotHistory& history = engine.history;
+	float span = history.size() > 1 ? history.timestamp(history.size() - 1) - history.timestamp(0) : 0.0f;
+	printf("  %d pages, %zu snapshots over %.1f s, %zu bytes\n", history.pageCount(), history.size(), span, history.memoryUsage());
+	expect(span > 2.0f, "more than 2 s of history");
+	engine.close();
+}
+
+/* how far the replay of a history is from the game it recorded, at every tick: location error of the car,
+   in uu */
+struct ReplayError {
+	float worst;
+	float mean;
+};
+
+static ReplayError replayError(bool adaptive, bool cubic, float tolerance) {
+	HeadlessWorld world(0);
+	Settings settings = defaultSettings();
+	RewindEngine engine;
+	engine.history.configure(4 * 1024 * 1024, false);	// the car leaves the arena the compressed history is quantized for
+	engine.recorder.setEnabled(adaptive);
+	engine.recorder.setTolerance(tolerance);
+	engine.start();
+
+	std::vector<WorldState> truth;	// every tick, at 120 Hz
+	std::vector<float> times;
+	world.ballResting = true;		// its spin would keep every snapshot, see checkSideState
+	world.input.Throttle = 1.0f;	// straight ahead, jumping every other second
+	for (int n = 0; n < 20 * 120; n++) {
+		world.step();
+		world.refresh();
+		engine.tick(world, settings, 0, 1);
+		engine.pipeline.drain();
+		truth.push_back(world.current());
+		times.push_back(world.secondsElapsed());
+	}
+	engine.recorder.flush(engine.history);
+
+	const SnapshotHistory& history = engine.history;
+	double sum = 0.0;
+	int samples = 0;
+	ReplayError error = ReplayError();
+	for (size_t n = 0; n < truth.size(); n++) {
+		float time = times[n];
+		if (time < history.timestamp(0) || time > history.timestamp(history.size() - 1)) continue;
+		size_t i = history.seek(time);
+		SnapshotFrame frame;
+		history.interpolate(i, i + 1 < history.size() ? i + 1 : i, time - history.timestamp(i), cubic, &frame);
+		const Vector& expected = truth[n].location[SNAPSHOT_CAR];
+		const float* replayed = frame.location.v + 4 * SNAPSHOT_CAR;
+		float dx = replayed[0] - expected.X, dy = replayed[1] - expected.Y, dz = replayed[2] - expected.Z;
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+		error.worst = fmaxf(error.worst, distance);
+		sum += distance;
+		samples++;
+	}
+	error.mean = samples ? (float)(sum / samples) : 0.0f;
+	printf("  %-32s %5zu snapshots, %6.2f uu worst, %5.2f uu mean\n", adaptive ? (cubic ? "adaptive, cubic" : "adaptive, linear")
+		: (cubic ? "every interval, cubic" : "every interval, linear"), history.size(), error.worst, error.mean);
+	engine.close();
+	return error;
+}
+
+/* the adaptive history, replayed with the cubic interpolation as the engine does, is as close to the game
+   as a snapshot every interval. Linear replays are shown for comparison */
+static void checkReplayError() {
+	Settings settings = defaultSettings();
+	printf("replay of 20 s recorded at %.0f ms, against the game at 120 Hz\n", settings.rewindSnapshotInterval * 1000.0f);
+	replayError(false, false, settings.rewindAdaptiveTolerance);
+	ReplayError fixed = replayError(false, true, settings.rewindAdaptiveTolerance);
+	replayError(true, false, settings.rewindAdaptiveTolerance);
+	ReplayError adaptive = replayError(true, true, settings.rewindAdaptiveTolerance);
+	expect(adaptive.mean < settings.rewindAdaptiveTolerance, "the adaptive history is within its tolerance on average");
+	expect(adaptive.worst < fixed.worst + 2.0f * settings.rewindAdaptiveTolerance, "the adaptive history is no worse than a snapshot every interval");
+}
+
+int main() {
+	checkSideState();
+	checkReplayError();
+	checkManyPages(3);
+	checkManyPages(8);
+	checkManyPages(30);
+	checkDetach(false);
+	checkDetach(true);
+	checkStillCapture();
+	printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+#include "GameFields.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+/*************************************************************************************************************
+ Field table benchmark
+
+ Runs each operation GameFields.h generates from GAME_FIELDS next to the same operation written by hand,
+ field by field, over states of a moving ball and car, and reports the time per state of both. The
+ results of both are compared first, the timings only mean something if they agree.
+**************************************************************************************************************/
+
+const int STATES = 256;		// fits in L1, the code is measured rather than the memory
+const int REPEATS = 4000;
+
+volatile int sink;	// keeps the results from being optimized away
+
+/* the best of a few runs in ns per state, the machine may be busy */
+template <typename Op>
+static double measure(Op op) {
+	double best = 1e9;
+	for (int run = 0; run < 9; run++) {
+		auto start = std::chrono::steady_clock::now();
+		for (int n = 0; n < REPEATS; n++)
+			op();
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / REPEATS / STATES);
+	}
+	return best;
+}
+
+static float random(float range) {
+	return range * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+static Vector randomVector(float range) {
+	return Vector(random(range), random(range), random(range));
+}
+
+
+/*************************************************************************************************************
+ The operations written by hand
+**************************************************************************************************************/
+
+static void captureByHand(GameFields& state, const WorldState& world) {
+	state.ball_location = world.location[SNAPSHOT_BALL];
+	state.car_location = world.location[SNAPSHOT_CAR];
+	state.ball_velocity = world.velocity[SNAPSHOT_BALL];
+	state.car_velocity = world.velocity[SNAPSHOT_CAR];
+	state.ball_ang_velocity = world.angularVelocity[SNAPSHOT_BALL];
+	state.car_ang_velocity = world.angularVelocity[SNAPSHOT_CAR];
+	state.boost_amount = world.boost;
+	state.ball_rotation = world.rotation[SNAPSHOT_BALL];
+	state.car_rotation = world.rotation[SNAPSHOT_CAR];
+}
+
+static void applyByHand(const GameFields& state, WorldState& world) {
+	world.location[SNAPSHOT_BALL] = state.ball_location;
+	world.location[SNAPSHOT_CAR] = state.car_location;
+	world.velocity[SNAPSHOT_BALL] = state.ball_velocity;
+	world.velocity[SNAPSHOT_CAR] = state.car_velocity;
+	world.angularVelocity[SNAPSHOT_BALL] = state.ball_ang_velocity;
+	world.angularVelocity[SNAPSHOT_CAR] = state.car_ang_velocity;
+	world.boost = state.boost_amount;
+	world.rotation[SNAPSHOT_BALL] = state.ball_rotation;
+	world.rotation[SNAPSHOT_CAR] = state.car_rotation;
+}
+
+static void packVector(float* lane, const Vector& v) {
+	lane[0] = v.X; lane[1] = v.Y; lane[2] = v.Z;
+}
+
+static void packQuaternion(float* lane, const Quaternion& q) {
+	lane[0] = q.x; lane[1] = q.y; lane[2] = q.z; lane[3] = q.w;
+}
+
+static void packByHand(const GameFields& state, SnapshotFrame& frame) {
+	packVector(frame.location.v + 4 * SNAPSHOT_BALL, state.ball_location);
+	packVector(frame.location.v + 4 * SNAPSHOT_CAR, state.car_location);
+	packVector(frame.velocity.v + 4 * SNAPSHOT_BALL, state.ball_velocity);
+	packVector(frame.velocity.v + 4 * SNAPSHOT_CAR, state.car_velocity);
+	packVector(frame.angularVelocity.v + 4 * SNAPSHOT_BALL, state.ball_ang_velocity);
+	packVector(frame.angularVelocity.v + 4 * SNAPSHOT_CAR, state.car_ang_velocity);
+	frame.angularVelocity.v[4 * SNAPSHOT_CAR + 3] = state.boost_amount;
+	packQuaternion(frame.rotation.v + 4 * SNAPSHOT_BALL, state.ball_rotation);
+	packQuaternion(frame.rotation.v + 4 * SNAPSHOT_CAR, state.car_rotation);
+}
+
+static Vector unpackVector(const float* lane) {
+	return Vector(lane[0], lane[1], lane[2]);
+}
+
+static Quaternion unpackQuaternion(const float* lane) {
+	return Quaternion{ lane[0], lane[1], lane[2], lane[3] };
+}
+
+static void unpackByHand(GameFields& state, const SnapshotFrame& frame) {
+	state.ball_location = unpackVector(frame.location.v + 4 * SNAPSHOT_BALL);
+	state.car_location = unpackVector(frame.location.v + 4 * SNAPSHOT_CAR);
+	state.ball_velocity = unpackVector(frame.velocity.v + 4 * SNAPSHOT_BALL);
+	state.car_velocity = unpackVector(frame.velocity.v + 4 * SNAPSHOT_CAR);
+	state.ball_ang_velocity = unpackVector(frame.angularVelocity.v + 4 * SNAPSHOT_BALL);
+	state.car_ang_velocity = unpackVector(frame.angularVelocity.v + 4 * SNAPSHOT_CAR);
+	state.boost_amount = frame.angularVelocity.v[4 * SNAPSHOT_CAR + 3];
+	state.ball_rotation = unpackQuaternion(frame.rotation.v + 4 * SNAPSHOT_BALL);
+	state.car_rotation = unpackQuaternion(frame.rotation.v + 4 * SNAPSHOT_CAR);
+}
+
+static bool sameVector(const Vector& a, const Vector& b) {
+	return a.X == b.X && a.Y == b.Y && a.Z == b.Z;
+}
+
+static bool sameQuaternion(const Quaternion& a, const Quaternion& b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+static bool sameByHand(const GameFields& a, const GameFields& b) {
+	return sameVector(a.ball_location, b.ball_location) && sameVector(a.car_location, b.car_location)
+		&& sameVector(a.ball_velocity, b.ball_velocity) && sameVector(a.car_velocity, b.car_velocity)
+		&& sameVector(a.ball_ang_velocity, b.ball_ang_velocity) && sameVector(a.car_ang_velocity, b.car_ang_velocity)
+		&& a.boost_amount == b.boost_amount
+		&& sameQuaternion(a.ball_rotation, b.ball_rotation) && sameQuaternion(a.car_rotation, b.car_rotation);
+}
+
+/* the lanes of QUANTIZED_LANES from lane, one per component */
+static int vectorDelta(int lane, const Vector& a, const Vector& b) {
+	const QuantizedLane* q = QUANTIZED_LANES + lane;
+	return varintBytes(quantizeLane(q[0], b.X) - quantizeLane(q[0], a.X))
+		+ varintBytes(quantizeLane(q[1], b.Y) - quantizeLane(q[1], a.Y))
+		+ varintBytes(quantizeLane(q[2], b.Z) - quantizeLane(q[2], a.Z));
+}
+
+static int quaternionDelta(int lane, const Quaternion& a, const Quaternion& b) {
+	const QuantizedLane* q = QUANTIZED_LANES + lane;
+	return varintBytes(quantizeLane(q[0], b.x) - quantizeLane(q[0], a.x))
+		+ varintBytes(quantizeLane(q[1], b.y) - quantizeLane(q[1], a.y))
+		+ varintBytes(quantizeLane(q[2], b.z) - quantizeLane(q[2], a.z))
+		+ varintBytes(quantizeLane(q[3], b.w) - quantizeLane(q[3], a.w));
+}
+
+static int deltaBytesByHand(const GameFields& a, const GameFields& b) {
+	return vectorDelta(0, a.ball_location, b.ball_location) + vectorDelta(3, a.car_location, b.car_location)
+		+ vectorDelta(6, a.ball_velocity, b.ball_velocity) + vectorDelta(9, a.car_velocity, b.car_velocity)
+		+ vectorDelta(12, a.ball_ang_velocity, b.ball_ang_velocity) + vectorDelta(15, a.car_ang_velocity, b.car_ang_velocity)
+		+ varintBytes(quantizeLane(QUANTIZED_LANES[18], b.boost_amount) - quantizeLane(QUANTIZED_LANES[18], a.boost_amount))
+		+ quaternionDelta(19, a.ball_rotation, b.ball_rotation) + quaternionDelta(23, a.car_rotation, b.car_rotation);
+}
+
+
+/*************************************************************************************************************
+ Both, state by state
+**************************************************************************************************************/
+
+static bool sameFrame(const SnapshotFrame& a, const SnapshotFrame& b) {
+	for (int channel = 0; channel < 4; channel++)
+		for (int lane = 0; lane < SNAPSHOT_CHANNEL_WIDTH; lane++)
+			if (channelOf(a, channel)[lane] != channelOf(b, channel)[lane]) return false;
+	return true;
+}
+
+static bool sameWorld(const WorldState& a, const WorldState& b) {
+	for (int body = 0; body < SNAPSHOT_BODIES; body++) {
+		if (!sameVector(a.location[body], b.location[body]) || !sameVector(a.velocity[body], b.velocity[body])
+			|| !sameVector(a.angularVelocity[body], b.angularVelocity[body]) || !sameQuaternion(a.rotation[body], b.rotation[body]))
+			return false;
+	}
+	return a.boost == b.boost;
+}
+
+int main() {
+	// states a tick apart, as the recorder compares and packs them, one in four at rest
+	std::vector<WorldState> worlds(STATES), generatedWorlds(STATES), handWorlds(STATES);
+	for (int n = 0; n < STATES; n++) {
+		WorldState& world = worlds[n];
+		if (n % 4 == 3) {
+			world = worlds[n - 1];
+			continue;
+		}
+		for (int body = 0; body < SNAPSHOT_BODIES; body++) {
+			world.velocity[body] = randomVector(2000.0f);
+			world.location[body] = n == 0 ? randomVector(3000.0f) : worlds[n - 1].location[body] + world.velocity[body] * (1.0f / 120.0f);
+			world.angularVelocity[body] = randomVector(5.0f);
+			world.rotation[body] = Quaternion{ 0.5f, -0.5f, 0.5f, 0.5f };
+		}
+		world.boost = (float)(rand() % 100);
+	}
+
+	std::vector<GameFields> generated(STATES), hand(STATES);
+	std::vector<SnapshotFrame> generatedFrames(STATES), handFrames(STATES);
+	bool agree = true;
+	for (int n = 0; n < STATES; n++) {
+		captureFields(generated[n], worlds[n]);
+		captureByHand(hand[n], worlds[n]);
+		applyFields(generated[n], generatedWorlds[n]);
+		applyByHand(hand[n], handWorlds[n]);
+		packFields(generated[n], generatedFrames[n]);
+		packByHand(hand[n], handFrames[n]);
+		GameFields generatedBack, handBack;
+		unpackFields(generatedBack, generatedFrames[n]);
+		unpackByHand(handBack, handFrames[n]);
+		agree = agree && sameByHand(generated[n], hand[n]) && sameWorld(generatedWorlds[n], handWorlds[n])
+			&& sameFrame(generatedFrames[n], handFrames[n]) && sameByHand(generatedBack, handBack);
+		if (n > 0) {
+			agree = agree && sameFields(generated[n - 1], generated[n]) == sameByHand(hand[n - 1], hand[n])
+				&& deltaBytes(generated[n - 1], generated[n]) == deltaBytesByHand(hand[n - 1], hand[n]);
+		}
+	}
+	if (!agree) {
+		printf("the generated and the hand-written operations disagree\n");
+		return 1;
+	}
+
+	int result = 0;
+	printf("%-12s %9s %9s   ns per state\n", "", "generated", "by hand");
+	double generatedTime = measure([&] { for (int n = 0; n < STATES; n++) captureFields(generated[n], worlds[n]); });
+	double handTime = measure([&] { for (int n = 0; n < STATES; n++) captureByHand(hand[n], worlds[n]); });
+	printf("%-12s %9.2f %9.2f\n", "capture", generatedTime, handTime);
+
+	generatedTime = measure([&] { for (int n = 0; n < STATES; n++) applyFields(generated[n], generatedWorlds[n]); });
+	handTime = measure([&] { for (int n = 0; n < STATES; n++) applyByHand(hand[n], handWorlds[n]); });
+	printf("%-12s %9.2f %9.2f\n", "apply", generatedTime, handTime);
+
+	generatedTime = measure([&] { for (int n = 0; n < STATES; n++) packFields(generated[n], generatedFrames[n]); });
+	handTime = measure([&] { for (int n = 0; n < STATES; n++) packByHand(hand[n], handFrames[n]); });
+	printf("%-12s %9.2f %9.2f\n", "pack", generatedTime, handTime);
+
+	generatedTime = measure([&] { for (int n = 0; n < STATES; n++) unpackFields(generated[n], generatedFrames[n]); });
+	handTime = measure([&] { for (int n = 0; n < STATES; n++) unpackByHand(hand[n], handFrames[n]); });
+	printf("%-12s %9.2f %9.2f\n", "unpack", generatedTime, handTime);
+
+	generatedTime = measure([&] { for (int n = 1; n < STATES; n++) result += sameFields(generated[n - 1], generated[n]); });
+	handTime = measure([&] { for (int n = 1; n < STATES; n++) result += sameByHand(hand[n - 1], hand[n]); });
+	printf("%-12s %9.2f %9.2f\n", "equality", generatedTime, handTime);
+
+	generatedTime = measure([&] { for (int n = 1; n < STATES; n++) result += deltaBytes(generated[n - 1], generated[n]); });
+	handTime = measure([&] { for (int n = 1; n < STATES; n++) result += deltaBytesByHand(hand[n - 1], hand[n]); });
+	printf("%-12s %9.2f %9.2f\n", "delta bytes", generatedTime, handTime);
+
+	sink = result;
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include "GameState.h"
+#include "RingBuffer.h"
+#include "SnapshotHistory.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+/*************************************************************************************************************
+ History container benchmark
+
+ Pushes snapshots into a full history and reads it back, with the history as the plugin first kept
+ it (a std::vector of GameState trimmed with erase(begin())), as a RingBuffer of GameState, and as the
+ ColumnHistory it is now, at history lengths of 100, 375 and 1000 snapshots.
+**************************************************************************************************************/
+
+Profiler profiler;
+
+const int REPEATS = 20000;
+
+volatile float sink;	// keeps the reads from being optimized away
+
+/* the best of a few runs in ns per call, the machine may be busy */
+template <typename Op>
+static double measure(int calls, Op op) {
+	double best = 1e9;
+	for (int run = 0; run < 9; run++) {
+		auto start = std::chrono::steady_clock::now();
+		for (int n = 0; n < calls; n++)
+			op(n);
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls);
+	}
+	return best;
+}
+
+static GameState snapshot(int n) {
+	GameState state;
+	state.ball_location = Vector((float)n, 0.0f, 93.0f);
+	state.car_location = Vector(0.0f, (float)n, 17.0f);
+	state.timestamp = n / 120.0f;
+	return state;
+}
+
+static void run(size_t length) {
+	std::vector<GameState> vector;
+	RingBuffer<GameState> ring(length);
+	ColumnHistory columns;
+	columns.setCapacity(length);
+	for (size_t n = 0; n < length; n++) {
+		GameState state = snapshot((int)n);
+		vector.push_back(state);
+		ring.push_back(state);
+		SnapshotFrame frame = state.toFrame();
+		columns.push_back(&frame, state.timestamp);
+	}
+	GameState state = snapshot(0);
+	SnapshotFrame frame = state.toFrame();
+
+	double vectorPush = measure(REPEATS / 10, [&](int) {
+		vector.erase(vector.begin());
+		vector.push_back(state);
+	});
+	double ringPush = measure(REPEATS, [&](int) { ring.push_back(state); });
+	double columnsPush = measure(REPEATS, [&](int) { columns.push_back(&frame, state.timestamp); });
+
+	// a pass over the whole history, as a scrub does one element at a time
+	float sum = 0.0f;
+	int passes = REPEATS / (int)length;
+	double vectorRead = measure(passes, [&](int) { for (size_t i = 0; i < length; i++) sum += vector[i].ball_location.X; }) / length;
+	double ringRead = measure(passes, [&](int) { for (size_t i = 0; i < length; i++) sum += ring[i].ball_location.X; }) / length;
+	double columnsRead = measure(passes, [&](int) { for (size_t i = 0; i < length; i++) sum += columns.view(i, 0).location->v[0]; }) / length;
+	sink = sum;
+
+	printf("%5zu  %9.1f %7.1f %7.1f   %6.2f %6.2f %6.2f\n", length, vectorPush, ringPush, columnsPush, vectorRead, ringRead, columnsRead);
+}
+
+int main() {
+	const size_t LENGTHS[] = { 100, 375, 1000 };	// about 3, 11 and 30 s at the default interval
+	printf("           push into a full history, ns     read, ns per snapshot\n");
+	printf("length     vector    ring columns   vector   ring columns\n");
+	for (size_t length : LENGTHS)
+		run(length);
+	return 0;
+}
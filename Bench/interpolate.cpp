@@ -0,0 +1,241 @@
+#include "SnapshotFrame.h"
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+/*************************************************************************************************************
+ Interpolation kernel benchmark
+
+ Blends pages of random bodies whose rotations are up to a few degrees apart, as between two snapshots,
+ and reports the time per page of the whole interpolation, of the rotation channel alone and of a plain
+ lerp of that channel (what the Euler kernel cost), with how far the blended rotations are from unit
+ length. A page holds the ball and the car, which is what the plugin first interpolated field by field,
+ with whole GameStates passed by value and CustomRotators: that is measured too, as the baseline, and
+ its rotations alone against nlerp and slerp. Last, rotations as far apart as the slerp fallback lets
+ nlerp blend them are checked against slerp, on both sides of SNAPSHOT_NLERP_MIN_DOT.
+ Built once for SSE2 (the plugin's build) and once for AVX.
+**************************************************************************************************************/
+
+const int PAGES = 256;		// fits in L1, the kernel is measured rather than the memory
+const int REPEATS = 4000;
+
+/* a model of the SDK's CustomRotator, which the SDK header is needed for: every component is a float
+   wrapped back into its range by each operation */
+struct CustomRotator {
+	float Pitch, Yaw, Roll;
+
+	CustomRotator(float pitch, float yaw, float roll) : Pitch(wrap(pitch, 16384.0f)), Yaw(wrap(yaw, 32768.0f)), Roll(wrap(roll, 32768.0f)) {}
+	explicit CustomRotator(float all) : CustomRotator(all, all, all) {}
+
+	CustomRotator operator+(const CustomRotator& r) const { return CustomRotator(Pitch + r.Pitch, Yaw + r.Yaw, Roll + r.Roll); }
+	CustomRotator operator*(const CustomRotator& r) const { return CustomRotator(Pitch * r.Pitch, Yaw * r.Yaw, Roll * r.Roll); }
+	CustomRotator operator/(const CustomRotator& r) const { return CustomRotator(Pitch / r.Pitch, Yaw / r.Yaw, Roll / r.Roll); }
+
+	/* the shortest way to r, component by component */
+	CustomRotator diffTo(const CustomRotator& r) const { return CustomRotator(r.Pitch - Pitch, r.Yaw - Yaw, r.Roll - Roll); }
+
+	static float wrap(float v, float half) {
+		v = fmodf(v + half, 2.0f * half);
+		return (v < 0.0f ? v + 2.0f * half : v) - half;
+	}
+};
+
+/* the GameState of the plugin before the history was columnar, and its interpolation */
+struct FieldState {
+	Vector ball_location, car_location, ball_velocity, car_velocity;
+	CustomRotator ball_rotation = CustomRotator(0.0f), car_rotation = CustomRotator(0.0f);
+	Vector ball_ang_velocity, car_ang_velocity;
+	float boost_amount, timestamp;
+
+	void interpolate(FieldState lhs, FieldState rhs, float elapsed, float interval) {
+		float custom_elapsed = elapsed * 1000;
+		float intval = interval * 1000;
+		CustomRotator snapR = CustomRotator(intval);
+		ball_location = blend(lhs.ball_location, rhs.ball_location, intval, custom_elapsed);
+		car_location = blend(lhs.car_location, rhs.car_location, intval, custom_elapsed);
+		ball_velocity = blend(lhs.ball_velocity, rhs.ball_velocity, intval, custom_elapsed);
+		car_velocity = blend(lhs.car_velocity, rhs.car_velocity, intval, custom_elapsed);
+		ball_rotation = lhs.ball_rotation + lhs.ball_rotation.diffTo(rhs.ball_rotation) / snapR * CustomRotator(custom_elapsed);
+		car_rotation = lhs.car_rotation + lhs.car_rotation.diffTo(rhs.car_rotation) / snapR * CustomRotator(custom_elapsed);
+		ball_ang_velocity = blend(lhs.ball_ang_velocity, rhs.ball_ang_velocity, intval, custom_elapsed);
+		car_ang_velocity = blend(lhs.car_ang_velocity, rhs.car_ang_velocity, intval, custom_elapsed);
+		boost_amount = lhs.boost_amount + (((rhs.boost_amount - lhs.boost_amount) / intval) * custom_elapsed);
+	}
+
+	/* lhs + (((rhs - lhs) / Vector(interval)) * elapsed), as the SDK's Vector operators did it */
+	static Vector blend(const Vector& lhs, const Vector& rhs, float interval, float elapsed) {
+		Vector d = rhs - lhs;
+		return lhs + Vector(d.X / interval, d.Y / interval, d.Z / interval) * elapsed;
+	}
+};
+
+static float random(float range) { return range * ((float)rand() / RAND_MAX - 0.5f); }
+
+static void randomQuaternion(float* q, const float* near) {
+	float length = 0.0f;
+	for (int i = 0; i < 4; i++) {
+		q[i] = near ? near[i] + random(0.05f) : random(1.0f);
+		length += q[i] * q[i];
+	}
+	length = sqrtf(length);
+	float sign = near && rand() % 2 ? -1.0f : 1.0f;		// either way around
+	for (int i = 0; i < 4; i++) q[i] *= sign / length;
+}
+
+/* the best of a few runs in ns per page, the machine may be busy */
+template <typename Kernel>
+static double measure(Kernel kernel) {
+	double best = 1e9;
+	for (int run = 0; run < 9; run++) {
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < REPEATS; r++)
+			kernel();
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double)REPEATS * PAGES));
+	}
+	return best;
+}
+
+/* the largest angle in degrees between the kernel's blend and slerp, for unit quaternions whose dot product
+   is cosine: b is a turned by 2 acos(cosine) around a random axis */
+static float angularError(float cosine) {
+	float worst = 0.0f;
+	for (int pair = 0; pair < 1000; pair++) {
+		float a[4], c[4];
+		randomQuaternion(a, nullptr);
+		randomQuaternion(c, nullptr);
+		float along = a[0] * c[0] + a[1] * c[1] + a[2] * c[2] + a[3] * c[3], length = 0.0f;
+		for (int i = 0; i < 4; i++) {
+			c[i] -= along * a[i];	// c is orthogonal to a
+			length += c[i] * c[i];
+		}
+		for (int i = 0; i < 4; i++) c[i] /= sqrtf(length);
+
+		float angle = acosf(cosine);
+		SnapshotChannel lhs = SnapshotChannel(), rhs = SnapshotChannel(), out;
+		for (int body = 0; body < SNAPSHOT_BODIES; body++)
+			for (int i = 0; i < 4; i++) {
+				lhs.v[4 * body + i] = a[i];
+				rhs.v[4 * body + i] = a[i] * cosine + c[i] * sinf(angle);
+			}
+		for (int step = 0; step <= 20; step++) {
+			float t = step / 20.0f;
+			nlerpRotationChannel(lhs, rhs, t, out);
+			// from the chord between the two, acos of their dot product is too coarse near 1
+			double near = 0.0, far = 0.0;
+			for (int i = 0; i < 4; i++) {
+				double exact = a[i] * cos((double)t * angle) + c[i] * sin((double)t * angle);
+				near += (out.v[i] - exact) * (out.v[i] - exact);
+				far += (out.v[i] + exact) * (out.v[i] + exact);
+			}
+			worst = fmaxf(worst, (float)(4.0 * asin(sqrt(fmin(near, far)) / 2.0) * 57.29578));
+		}
+	}
+	return worst;
+}
+
+static float unitError(const std::vector<SnapshotFrame>& frames) {
+	float error = 0.0f;
+	for (const SnapshotFrame& frame : frames)
+		for (int body = 0; body < SNAPSHOT_BODIES; body++) {
+			const float* q = frame.rotation.v + 4 * body;
+			error = fmaxf(error, fabsf(sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]) - 1.0f));
+		}
+	return error;
+}
+
+int main() {
+	std::vector<SnapshotFrame> lhs(PAGES), rhs(PAGES), out(PAGES);
+	std::vector<SnapshotView> lhsViews, rhsViews;
+	std::vector<float> t(PAGES);
+	for (int n = 0; n < PAGES; n++) {
+		for (int i = 0; i < SNAPSHOT_CHANNEL_WIDTH; i++) {
+			lhs[n].location.v[i] = random(8000.0f);
+			rhs[n].location.v[i] = lhs[n].location.v[i] + random(20.0f);
+			lhs[n].velocity.v[i] = rhs[n].velocity.v[i] = random(4000.0f);
+			lhs[n].angularVelocity.v[i] = rhs[n].angularVelocity.v[i] = random(10.0f);
+		}
+		for (int body = 0; body < SNAPSHOT_BODIES; body++) {
+			randomQuaternion(lhs[n].rotation.v + 4 * body, nullptr);
+			randomQuaternion(rhs[n].rotation.v + 4 * body, lhs[n].rotation.v + 4 * body);
+		}
+		lhsViews.push_back(SnapshotView::of(lhs[n]));
+		rhsViews.push_back(SnapshotView::of(rhs[n]));
+		t[n] = (float)rand() / RAND_MAX;
+	}
+
+#if defined(__AVX__)
+	printf("AVX\n");
+#else
+	printf("SSE2\n");
+#endif
+	double page = measure([&] { interpolateSnapshots(lhsViews.data(), rhsViews.data(), t.data(), out.data(), PAGES); });
+	printf("%-28s %6.2f ns/page\n", "interpolateSnapshots", page);
+
+	std::vector<FieldState> fieldLhs(PAGES), fieldRhs(PAGES), fieldOut(PAGES);
+	for (int n = 0; n < PAGES; n++) {
+		FieldState* states[] = { &fieldLhs[n], &fieldRhs[n] };
+		const SnapshotFrame* frames[] = { &lhs[n], &rhs[n] };
+		for (int side = 0; side < 2; side++) {
+			FieldState& state = *states[side];
+			const float* location = frames[side]->location.v;
+			const float* velocity = frames[side]->velocity.v;
+			const float* spin = frames[side]->angularVelocity.v;
+			state.ball_location = Vector(location[0], location[1], location[2]);
+			state.car_location = Vector(location[4], location[5], location[6]);
+			state.ball_velocity = Vector(velocity[0], velocity[1], velocity[2]);
+			state.car_velocity = Vector(velocity[4], velocity[5], velocity[6]);
+			state.ball_ang_velocity = Vector(spin[0], spin[1], spin[2]);
+			state.car_ang_velocity = Vector(spin[4], spin[5], spin[6]);
+			state.ball_rotation = side ? fieldLhs[n].ball_rotation + CustomRotator(random(1000.0f)) : CustomRotator(random(32768.0f), random(65536.0f), random(65536.0f));
+			state.car_rotation = side ? fieldLhs[n].car_rotation + CustomRotator(random(1000.0f)) : CustomRotator(random(32768.0f), random(65536.0f), random(65536.0f));
+			state.boost_amount = spin[7];
+			state.timestamp = 0.0f;
+		}
+	}
+	double fields = measure([&] {
+		for (int n = 0; n < PAGES; n++) fieldOut[n].interpolate(fieldLhs[n], fieldRhs[n], t[n] * 0.03f, 0.03f);
+	});
+	printf("%-28s %6.2f ns/page\n", "per field, by value", fields);
+
+	double rotators = measure([&] {
+		for (int n = 0; n < PAGES; n++) {
+			CustomRotator snapR = CustomRotator(30.0f), elapsed = CustomRotator(t[n] * 30.0f);
+			fieldOut[n].ball_rotation = fieldLhs[n].ball_rotation + fieldLhs[n].ball_rotation.diffTo(fieldRhs[n].ball_rotation) / snapR * elapsed;
+			fieldOut[n].car_rotation = fieldLhs[n].car_rotation + fieldLhs[n].car_rotation.diffTo(fieldRhs[n].car_rotation) / snapR * elapsed;
+		}
+	});
+	printf("%-28s %6.2f ns/page\n", "rotation, CustomRotator", rotators);
+
+	double slerp = measure([&] {
+		for (int n = 0; n < PAGES; n++)
+			for (int body = 0; body < SNAPSHOT_BODIES; body++)
+				slerpLane(lhs[n].rotation.v + 4 * body, rhs[n].rotation.v + 4 * body, t[n], out[n].rotation.v + 4 * body);
+	});
+	printf("%-28s %6.2f ns/page, unit length within %.1e\n", "rotation, slerp", slerp, unitError(out));
+
+	double rotation = measure([&] {
+		for (int n = 0; n < PAGES; n++) nlerpRotationChannel(lhs[n].rotation, rhs[n].rotation, t[n], out[n].rotation);
+	});
+	printf("%-28s %6.2f ns/page, unit length within %.1e\n", "rotation, nlerp", rotation, unitError(out));
+
+	double lerp = measure([&] {
+		for (int n = 0; n < PAGES; n++) {
+			SnapshotChannel& channel = out[n].rotation;
+#if defined(__AVX__)
+			lerpChannel(lhs[n].rotation, rhs[n].rotation, _mm256_set1_ps(t[n]), channel);
+#else
+			lerpChannel(lhs[n].rotation, rhs[n].rotation, _mm_set1_ps(t[n]), channel);
+#endif
+		}
+	});
+	printf("%-28s %6.2f ns/page\n", "rotation, lerp only", lerp);
+
+	// just above the threshold the kernel's nlerp is used, just below its slerp fallback
+	float degrees = 2.0f * acosf(SNAPSHOT_NLERP_MIN_DOT) * 57.2958f;
+	printf("%-28s %6.3f degrees from slerp, %.1f degrees apart\n", "nlerp at the threshold", angularError(SNAPSHOT_NLERP_MIN_DOT + 1e-4f), degrees);
+	printf("%-28s %6.3f degrees from slerp\n", "slerp fallback", angularError(SNAPSHOT_NLERP_MIN_DOT - 1e-4f));
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "HeadlessCanvas.h"
+#include "Measure.h"
+#include "Overlay.h"
+#include <chrono>
+#include <cstdio>
+
+
+/*************************************************************************************************************
+ Overlay benchmark
+
+ Draws a scripted minute of play at 60 frames per second for each overlay configuration, and replays
+ every frame onto a HeadlessCanvas as render does onto the game's canvas. Reports the draw calls, the
+ state calls (colors, positions) and the CPU time per frame on the plugin's side. What the game then
+ spends on each call is not measured.
+**************************************************************************************************************/
+
+Profiler profiler;
+
+/* recording, rewinding backward, holding the rewind still, forward, then playing again */
+static RewindFrame scriptedFrame(int frame) {
+	const int CYCLE = 600;
+	int t = frame % CYCLE;
+	RewindFrame f = RewindFrame();
+	f.active = true;
+	f.secondsElapsed = frame / 60.0f;
+	f.rewinderEnabled = t >= 120 && t < 420;
+	f.rewindBackward = t >= 120 && t < 240;
+	f.rewindForward = t >= 300 && t < 420;
+	f.startShot = t < 120;
+	return f;
+}
+
+struct Configuration {
+	const char* name;
+	bool filter, lines, icons, autoHide, stats;
+};
+
+static void run(const Configuration& c) {
+	Settings settings = defaultSettings();
+	settings.filterShow = c.filter;
+	settings.filterRewindLines = c.lines;
+	settings.iconsShow = c.icons;
+	settings.iconsAutoHide = c.autoHide;
+	settings.statsGraph = c.stats;
+
+	Overlay overlay;
+	HeadlessCanvas canvas;
+	const int FRAMES = 60 * 60;
+
+	for (int frame = 0; frame < 600; frame++)	// warms the buffers up, as the first seconds in game do
+		overlay.draw(scriptedFrame(frame), 1920.0f, 1080.0f, settings, true);
+
+	uint64_t before = allocations.load();
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < FRAMES; frame++) {
+		overlay.draw(scriptedFrame(frame), 1920.0f, 1080.0f, settings, true);
+		overlay.commands.replay(canvas);
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%-24s %7.1f draws/frame %7.1f states/frame %8.0f ns/frame %6.2f allocs/frame\n", c.name, (double)canvas.draws / FRAMES,
+		(double)canvas.states / FRAMES, ns / FRAMES, (double)(allocations.load() - before) / FRAMES);
+	volatile float drawn = canvas.checksum;	// keeps the replay
+	(void)drawn;
+}
+
+int main() {
+	const Configuration configurations[] = {
+		{ "nothing", false, false, false, false, false },
+		{ "filter", true, false, false, false, false },
+		{ "rewind lines", false, true, false, false, false },
+		{ "icons", false, false, true, false, false },
+		{ "icons, auto-hide", false, false, true, true, false },
+		{ "defaults", true, true, true, true, false },
+		{ "everything, no hide", true, true, true, false, false },
+		{ "defaults and stats", true, true, true, true, true },
+	};
+	for (const Configuration& c : configurations)
+		run(c);
+	return 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/*************************************************************************************************************
+ The wrappers of the BakkesMod SDK that BakkesWorld calls, with the SDK's names and signatures, so the
+ benchmark can run BakkesWorld itself. They read and write the actors of StandinGame, a server whose
+ physics is a plain ballistic step, and count every call: in the game each one goes through the
+ engine, they are what BakkesWorld pays for.
+**************************************************************************************************************/
+
+struct StandinActor {
+	Vector location;
+	Vector velocity;
+	Vector angularVelocity;
+	Rotator rotation;
+	float boost;
+	unsigned long frozen;
+	unsigned long jumped;
+	unsigned long doubleJumped;
+	float jumpTime;
+	float dodgeTime;
+};
+
+/* actor 0 is what a null wrapper points at, then the balls, then the cars: the player's car is the first */
+struct StandinGame {
+	std::vector<StandinActor> actors;
+	int balls = 0;
+	int cars = 0;
+	float seconds = 0.0f;
+	uint64_t reads = 0;
+	uint64_t writes = 0;
+
+	void reset(int ballCount, int carCount) {
+		actors.assign(1 + ballCount + carCount, StandinActor());
+		balls = ballCount;
+		cars = carCount;
+		seconds = 0.0f;
+		reads = writes = 0;
+	}
+
+	uintptr_t ball(int n) const { return 1 + n; }
+	uintptr_t car(int n) const { return 1 + balls + n; }
+
+	/* one physics tick: bodies fly and fall until they reach the ground, the jump timers run */
+	void step(float dt) {
+		seconds += dt;
+		for (size_t n = 1; n < actors.size(); n++) {
+			StandinActor& a = actors[n];
+			if (a.jumped) a.jumpTime += dt;
+			if (a.doubleJumped) a.dodgeTime += dt;
+			if (a.frozen) continue;
+			a.velocity.Z -= 650.0f * dt;
+			a.location = a.location + a.velocity * dt;
+			if (a.location.Z < 17.0f) {
+				a.location.Z = 17.0f;
+				a.velocity.Z = 0.0f;
+			}
+			a.rotation.Yaw += (int)(a.angularVelocity.Z * dt * 10430.0f);
+		}
+	}
+};
+
+inline StandinGame& standinGame() {
+	static StandinGame game;
+	return game;
+}
+
+class ObjectWrapper {
+public:
+	uintptr_t memory_address;
+	explicit ObjectWrapper(uintptr_t address) : memory_address(address) {}
+	bool IsNull() const { return memory_address == 0; }
+
+protected:
+	StandinActor& actor() const { return standinGame().actors[memory_address]; }
+	template <typename T> static T read(const T& value) { standinGame().reads++; return value; }
+	template <typename T> static void write(T& field, const T& value) { standinGame().writes++; field = value; }
+};
+
+class PriWrapper : public ObjectWrapper {
+public:
+	explicit PriWrapper(uintptr_t address) : ObjectWrapper(address) {}
+};
+
+class ActorWrapper : public ObjectWrapper {
+public:
+	explicit ActorWrapper(uintptr_t address) : ObjectWrapper(address) {}
+	Vector GetLocation() { return read(actor().location); }
+	Vector GetVelocity() { return read(actor().velocity); }
+	Vector GetAngularVelocity() { return read(actor().angularVelocity); }
+	Rotator GetRotation() { return read(actor().rotation); }
+	void SetLocation(const Vector location) { write(actor().location, location); }
+	void SetVelocity(const Vector velocity) { write(actor().velocity, velocity); }
+	void SetRotation(const Rotator rotation) { write(actor().rotation, rotation); }
+	void SetAngularVelocity(const Vector velocity, bool) { write(actor().angularVelocity, velocity); }
+};
+
+class BallWrapper : public ActorWrapper {
+public:
+	explicit BallWrapper(uintptr_t address) : ActorWrapper(address) {}
+	unsigned long GetbFrozen() { return read(actor().frozen); }
+	void SetFrozen(unsigned long frozen) { write(actor().frozen, frozen); }
+};
+
+class BoostWrapper : public ObjectWrapper {
+public:
+	explicit BoostWrapper(uintptr_t address) : ObjectWrapper(address) {}
+	float GetCurrentBoostAmount() { return read(actor().boost); }
+	void SetBoostAmount(float amount) { write(actor().boost, amount); }
+};
+
+class JumpComponentWrapper : public ObjectWrapper {
+public:
+	explicit JumpComponentWrapper(uintptr_t address) : ObjectWrapper(address) {}
+	float GetActivityTime() { return read(actor().jumpTime); }
+	void SetActivityTime(float time) { write(actor().jumpTime, time); }
+};
+
+class DodgeComponentWrapper : public ObjectWrapper {
+public:
+	explicit DodgeComponentWrapper(uintptr_t address) : ObjectWrapper(address) {}
+	float GetActivityTime() { return read(actor().dodgeTime); }
+	void SetActivityTime(float time) { write(actor().dodgeTime, time); }
+};
+
+/* the components of a car are stand-ins on the car's own actor */
+class CarWrapper : public ActorWrapper {
+public:
+	explicit CarWrapper(uintptr_t address) : ActorWrapper(address) {}
+	BoostWrapper GetBoostComponent() { standinGame().reads++; return BoostWrapper(memory_address); }
+	JumpComponentWrapper GetJumpComponent() { standinGame().reads++; return JumpComponentWrapper(memory_address); }
+	DodgeComponentWrapper GetDodgeComponent() { standinGame().reads++; return DodgeComponentWrapper(memory_address); }
+	unsigned long GetbIsMoving() { standinGame().reads++; return 1; }
+	ControllerInput GetInput() { standinGame().reads++; return ControllerInput(); }
+	unsigned long GetbJumped() { return read(actor().jumped); }
+	unsigned long GetbDoubleJumped() { return read(actor().doubleJumped); }
+	void SetbJumped(unsigned long jumped) { write(actor().jumped, jumped); }
+	void SetbDoubleJumped(unsigned long doubleJumped) { write(actor().doubleJumped, doubleJumped); }
+	void SetDriving(unsigned long) { standinGame().writes++; }
+};
+
+class VehiclePickupWrapper : public ObjectWrapper {
+public:
+	explicit VehiclePickupWrapper(uintptr_t address) : ObjectWrapper(address) {}
+	float GetRespawnDelay() { standinGame().reads++; return 10.0f; }
+	void SetRespawnDelay(float) { standinGame().writes++; }
+	void SetPickedUp(unsigned long, PriWrapper) { standinGame().writes++; }
+	void Respawn() { standinGame().writes++; }
+};
+
+template <typename T>
+class ArrayWrapper {
+public:
+	ArrayWrapper(uintptr_t first, int count) : first(first), count(count) {}
+	int Count() { return count; }
+	T Get(int index) { standinGame().reads++; return T(first + index); }
+
+private:
+	uintptr_t first;
+	int count;
+};
+
+class ServerWrapper : public ObjectWrapper {
+public:
+	explicit ServerWrapper(uintptr_t address) : ObjectWrapper(address) {}
+	BallWrapper GetBall() { standinGame().reads++; return BallWrapper(standinGame().ball(0)); }
+	CarWrapper GetGameCar() { standinGame().reads++; return CarWrapper(standinGame().car(0)); }
+	ArrayWrapper<BallWrapper> GetGameBalls() { standinGame().reads++; return ArrayWrapper<BallWrapper>(standinGame().ball(0), standinGame().balls); }
+	ArrayWrapper<CarWrapper> GetCars() { standinGame().reads++; return ArrayWrapper<CarWrapper>(standinGame().car(0), standinGame().cars); }
+	float GetSecondsElapsed() { return read(standinGame().seconds); }
+	bool IsInGoal(Vector) { standinGame().reads++; return false; }
+};
+
+class GameWrapper {
+public:
+	ServerWrapper GetGameEventAsServer() { standinGame().reads++; return ServerWrapper(standinGame().actors.empty() ? 0 : 1); }
+	bool IsKeyPressed(int) { return false; }
+	bool IsPaused() { standinGame().reads++; return false; }
+};
+
+class CVarWrapper {
+public:
+	bool IsNull() { return false; }
+	bool getBoolValue() { return value; }
+	void setValue(bool b) { value = b; }
+	void addOnValueChanged(std::function<void(std::string, CVarWrapper)>) {}
+
+private:
+	bool value = false;
+};
+
+class CVarManagerWrapper {
+public:
+	CVarWrapper getCvar(std::string) { return CVarWrapper(); }
+};
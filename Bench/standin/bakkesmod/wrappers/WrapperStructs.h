@@ -0,0 +1,50 @@
+#pragma once
+
+
+/*************************************************************************************************************
+ The plain structs of the BakkesMod SDK the engine headers use, laid out as in the SDK, so the engine
+ builds on its own. Nothing of the wrappers is here: the engine runs on HeadlessWorld, and the stand-ins
+ of the wrappers BakkesWorld calls are in bakkesmod/plugin/bakkesmodplugin.h.
+**************************************************************************************************************/
+
+struct Vector {
+	float X, Y, Z;
+	Vector() : X(0), Y(0), Z(0) {}
+	Vector(float x, float y, float z) : X(x), Y(y), Z(z) {}
+	Vector operator+(const Vector& v) const { return Vector(X + v.X, Y + v.Y, Z + v.Z); }
+	Vector operator-(const Vector& v) const { return Vector(X - v.X, Y - v.Y, Z - v.Z); }
+	Vector operator*(float f) const { return Vector(X * f, Y * f, Z * f); }
+};
+
+struct Rotator {
+	int Pitch, Yaw, Roll;
+	Rotator() : Pitch(0), Yaw(0), Roll(0) {}
+	Rotator(int pitch, int yaw, int roll) : Pitch(pitch), Yaw(yaw), Roll(roll) {}
+};
+
+struct Vector2 {
+	int X, Y;
+};
+
+struct Vector2F {
+	float X, Y;
+};
+
+struct LinearColor {
+	float R, G, B, A;
+};
+
+struct ControllerInput {
+	float Throttle;
+	float Steer;
+	float Pitch;
+	float Yaw;
+	float Roll;
+	float DodgeForward;
+	float DodgeStrafe;
+	unsigned long Handbrake : 1;
+	unsigned long Jump : 1;
+	unsigned long ActivateBoost : 1;
+	unsigned long HoldingBoost : 1;
+	unsigned long Jumped : 1;
+};
@@ -0,0 +1,100 @@
+#include "BakkesWorld.h"
+#include "Measure.h"
+#include <chrono>
+#include <cstdio>
+
+
+/*************************************************************************************************************
+ BakkesWorld benchmark
+
+ Runs BakkesWorld over the stand-in wrappers (standin/bakkesmod/plugin) and reports, for each scenario,
+ the wrapper calls per tick, which is what the game charges for, and the time per tick spent in
+ BakkesWorld itself, the stand-in calls being almost free.
+**************************************************************************************************************/
+
+const float TICK = 1.0f / 120.0f;
+
+class Bench
+{
+public:
+	Bench(int otherCars) : world(std::make_shared<GameWrapper>(), std::make_shared<CVarManagerWrapper>()) {
+		StandinGame& game = standinGame();
+		game.reset(1, 1 + otherCars);
+		for (int n = 0; n <= otherCars; n++) {
+			StandinActor& car = game.actors[game.car(n)];
+			car.location = Vector(-500.0f + 250.0f * n, 0.0f, 17.0f);
+			car.rotation = Rotator(0, 16384 * n, 0);
+			car.boost = 0.33f;
+		}
+		game.actors[game.ball(0)].location = Vector(0.0f, 0.0f, 93.0f);
+	}
+
+	/* everything flies: the ball and the cars go up, the player's car after a jump */
+	void launch() {
+		StandinGame& game = standinGame();
+		for (size_t n = 1; n < game.actors.size(); n++) {
+			StandinActor& a = game.actors[n];
+			a.location.Z = 300.0f + 20.0f * n;
+			a.velocity = Vector(400.0f, -200.0f, 600.0f);
+			a.angularVelocity = Vector(0.0f, 1.0f, 2.0f);
+		}
+		StandinActor& car = game.actors[game.car(0)];
+		car.jumped = 1;
+		car.jumpTime = 0.1f;
+	}
+
+	/* runs a scenario, then prints its wrapper calls and time per tick */
+	template <typename Scenario>
+	void measure(const char* name, int ticks, Scenario scenario) {
+		StandinGame& game = standinGame();
+		uint64_t reads = game.reads, writes = game.writes;
+		auto start = std::chrono::steady_clock::now();
+		for (int n = 0; n < ticks; n++)
+			scenario();
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		printf("%-28s %7.2f reads/tick %7.2f writes/tick %7.0f ns/tick\n", name, (double)(game.reads - reads) / ticks,
+			(double)(game.writes - writes) / ticks, ns / ticks);
+	}
+
+	BakkesWorld world;
+};
+
+
+static void run(int otherCars) {
+	printf("freeplay with %d other cars\n", otherCars);
+	Bench bench(otherCars);
+	StandinGame& game = standinGame();
+	const int TICKS = 120 * 120;
+	WorldState state;
+
+	bench.world.refresh();
+	bench.measure("capture at rest", TICKS, [&] {
+		game.step(TICK);
+		bench.world.refresh();
+		bench.world.capture(state);
+	});
+	bench.measure("replay at rest", TICKS, [&] {
+		game.step(TICK);
+		bench.world.refresh();
+		bench.world.apply(state);
+	});
+
+	bench.launch();
+	bench.measure("capture in the air", TICKS / 60, [&] {
+		game.step(TICK);
+		bench.world.refresh();
+		bench.world.capture(state);
+	});
+	bench.measure("replay paused mid-air", TICKS, [&] {
+		game.step(TICK);
+		bench.world.refresh();
+		bench.world.apply(state);
+	});
+	printf("\n");
+}
+
+int main() {
+	run(0);
+	run(3);
+	return 0;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include "SnapshotHistory.h"
+#include <cmath>
+#include <algorithm>
+
+
+/*************************************************************************************************************
+ Adaptive snapshot decimation
+
+ Every captured snapshot is compared to what the last kept one predicts (constant velocity, with and
+ without gravity, so both free flight and rolling/driving are covered). It is only stored when the
+ prediction is off by more than the tolerance, which happens on contacts, bounces, steering and boost.
+ The snapshot just before the deviation is stored too so the contact is bracketed, and the cubic
+ interpolation rebuilds the dropped snapshots from the velocities of the kept ones.
+ A jump, a dodge or a pad pickup is a deviation too. Every snapshot is stored with the jump state and
+ the pads it was captured with, so the one bracketing a jump still has the jump to do.
+**************************************************************************************************************/
+
+const float ARENA_GRAVITY = -650.0f;		// uu/s^2
+const float ADAPTIVE_MAX_GAP = 0.5f;		// seconds, bounds rotation and drag error
+const float ADAPTIVE_MAX_TURN = 0.6f;		// radians a body may spin between two kept snapshots
+const float ADAPTIVE_SPIN_TOLERANCE = 0.5f;	// rad/s
+const float ADAPTIVE_BOOST_TOLERANCE = 0.05f;
+
+class AdaptiveRecorder
+{
+public:
+	AdaptiveRecorder() : enabled(false), tolerance(2.0f), keptTimestamp(0.0f), keptJump(), keptPads(0), hasKept(false),
+		pendingTimestamp(0.0f), pendingJump(), pendingPads(0), hasPending(false), captured(0), kept(0) {}
+
+	void setEnabled(bool b) {
+		enabled = b;
+		hasPending = false;
+	}
+
+	bool isEnabled() const { return enabled; }
+
+	/* location error allowed, in uu. Velocities get ten times that in uu/s */
+	void setTolerance(float uu) { tolerance = uu; }
+
+	/* must be called whenever the history is cleared */
+	void reset() {
+		hasKept = false;
+		hasPending = false;
+	}
+
+	/* frames holds one frame per page of the history, jump and pads the side state captured with them */
+	void record(const SnapshotFrame* frames, float timestamp, const JumpState& jump, uint64_t pads, SnapshotHistory& history) {
+		captured++;
+		int pages = history.pageCount();
+
+		if (!enabled || !hasKept || timestamp - keptTimestamp > ADAPTIVE_MAX_GAP || deviates(frames, pages, timestamp)
+			|| !jump.follows(keptJump, timestamp - keptTimestamp) || pads != keptPads) {
+			if (hasPending && enabled && hasKept)	// bracket the contact with the last predictable snapshot
+				keep(pending, pendingTimestamp, pendingJump, pendingPads, history);
+			keep(frames, timestamp, jump, pads, history);
+			return;
+		}
+
+		std::copy(frames, frames + pages, pending);
+		pendingTimestamp = timestamp;
+		pendingJump = jump;
+		pendingPads = pads;
+		hasPending = true;
+	}
+
+	/* stores the latest dropped snapshot, so that the history ends at the current state */
+	void flush(SnapshotHistory& history) {
+		if (hasPending)
+			keep(pending, pendingTimestamp, pendingJump, pendingPads, history);
+	}
+
+	long long capturedCount() const { return captured; }
+	long long keptCount() const { return kept; }
+
+private:
+	void keep(const SnapshotFrame* frames, float timestamp, const JumpState& jump, uint64_t pads, SnapshotHistory& history) {
+		history.push_back(frames, timestamp, jump, pads);
+		std::copy(frames, frames + history.pageCount(), last);
+		keptTimestamp = timestamp;
+		keptJump = jump;
+		keptPads = pads;
+		hasKept = true;
+		hasPending = false;
+		kept++;
+	}
+
+	bool deviates(const SnapshotFrame* frames, int pages, float timestamp) const {
+		float dt = timestamp - keptTimestamp;
+
+		for (int n = 0; n < pages * SNAPSHOT_BODIES; n++) {
+			const SnapshotFrame& before = last[n / SNAPSHOT_BODIES];
+			const SnapshotFrame& frame = frames[n / SNAPSHOT_BODIES];
+			int body = n % SNAPSHOT_BODIES;
+			const float* p0 = before.location.v + 4 * body;
+			const float* v0 = before.velocity.v + 4 * body;
+			const float* p = frame.location.v + 4 * body;
+			const float* v = frame.velocity.v + 4 * body;
+
+			// on the ground gravity is cancelled out, in the air it is not: keep the better guess
+			float ballistic = predictionError(p0, v0, p, v, dt, ARENA_GRAVITY);
+			float grounded = predictionError(p0, v0, p, v, dt, 0.0f);
+			if (fminf(ballistic, grounded) > 1.0f)
+				return true;
+
+			const float* w0 = before.angularVelocity.v + 4 * body;
+			const float* w = frame.angularVelocity.v + 4 * body;
+			float spin = sqrtf(w0[0] * w0[0] + w0[1] * w0[1] + w0[2] * w0[2]);
+			if (spin * dt > ADAPTIVE_MAX_TURN)
+				return true;
+			if (fabsf(w[0] - w0[0]) > ADAPTIVE_SPIN_TOLERANCE || fabsf(w[1] - w0[1]) > ADAPTIVE_SPIN_TOLERANCE
+				|| fabsf(w[2] - w0[2]) > ADAPTIVE_SPIN_TOLERANCE)
+				return true;
+
+			// the boost of a car, always 0 for a ball
+			if (fabsf(w[3] - w0[3]) > ADAPTIVE_BOOST_TOLERANCE)
+				return true;
+		}
+		return false;
+	}
+
+	/* worst of location and velocity error, relative to their tolerance */
+	float predictionError(const float* p0, const float* v0, const float* p, const float* v, float dt, float gravity) const {
+		float worst = 0.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			float g = axis == 2 ? gravity : 0.0f;
+			float location = p0[axis] + v0[axis] * dt + 0.5f * g * dt * dt;
+			float velocity = v0[axis] + g * dt;
+			worst = fmaxf(worst, fabsf(p[axis] - location) / tolerance);
+			worst = fmaxf(worst, fabsf(v[axis] - velocity) / (10.0f * tolerance));
+		}
+		return worst;
+	}
+
+	bool enabled;
+	float tolerance;
+
+	SnapshotFrame last[SNAPSHOT_MAX_PAGES];		// last stored snapshot, the prediction base
+	float keptTimestamp;
+	JumpState keptJump;
+	uint64_t keptPads;
+	bool hasKept;
+
+	SnapshotFrame pending[SNAPSHOT_MAX_PAGES];	// last dropped snapshot
+	float pendingTimestamp;
+	JumpState pendingJump;
+	uint64_t pendingPads;
+	bool hasPending;
+
+	long long captured;
+	long long kept;
+};
@@ -0,0 +1,502 @@
+#pragma once
+#include "SpscQueue.h"
+#include "Resampler.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
+#ifdef _WIN32
+#include <windows.h>
+#include <MMSystem.h>
+#endif
+
+
+/*************************************************************************************************************
+ Sound mixer
+
+ Sounds are decoded to stereo float PCM when loaded. A dedicated thread mixes the playing voices into
+ small blocks and hands them to a backend: waveOut in the game, or a null or file backend anywhere
+ else. The render thread, which plays and stops the sounds, pushes commands into a lock-free queue
+ of which it is the only producer, so playing a sound never blocks a frame, and isPlaying reflects
+ what the audio thread actually plays. Voices go through the sinc resampler, so each one can be sped
+ up or slowed down (pitch included) from one block to the next: the speed of a sound is an atomic
+ that any thread sets and the audio thread reads once per block.
+**************************************************************************************************************/
+
+const int MIXER_SAMPLE_RATE = 44100;
+const int MIXER_CHANNELS = 2;
+const int MIXER_BLOCK_FRAMES = 441;	// 10 ms
+const int MIXER_VOICES = 8;
+const int MIXER_SOUNDS = 16;
+
+const int SOUND_PADDING = RESAMPLER_MAX_TAPS / 2;	// frames the resampler reads past both ends
+
+/* one buffer per channel, padded with the other end of the sound so loops wrap without a click */
+struct DecodedSound {
+	std::vector<float> channels[MIXER_CHANNELS];
+	size_t frames;
+	int sampleRate;
+
+	const float* channel(int c) const { return channels[c].data() + SOUND_PADDING; }
+
+	void pad() {
+		for (std::vector<float>& samples : channels) {
+			for (int i = 0; i < SOUND_PADDING; i++) {
+				samples[SOUND_PADDING - 1 - i] = samples[SOUND_PADDING + frames - 1 - i % frames];
+				samples[SOUND_PADDING + frames + i] = samples[SOUND_PADDING + i % frames];
+			}
+		}
+	}
+};
+
+inline bool hasTag(const uint8_t* p, const char* tag) {
+	return std::equal(p, p + 4, (const uint8_t*)tag);
+}
+
+inline uint32_t readLE(const uint8_t* p, int bytes) {
+	uint32_t v = 0;
+	for (int i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+/* PCM (8, 16, 24 or 32 bits) and float .wav files, mono or stereo */
+inline bool decodeWav(const char* filename, DecodedSound& sound) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) return false;
+	std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (bytes.size() < 12 || !hasTag(bytes.data(), "RIFF") || !hasTag(bytes.data() + 8, "WAVE"))
+		return false;
+
+	int format = 0, channels = 0, bits = 0;
+	uint32_t rate = 0;
+	const uint8_t* data = nullptr;
+	size_t dataSize = 0;
+
+	for (size_t pos = 12; pos + 8 <= bytes.size();) {
+		const uint8_t* chunk = bytes.data() + pos;
+		size_t size = readLE(chunk + 4, 4);
+		size_t available = bytes.size() - pos - 8;
+		if (size > available) size = available;
+
+		if (hasTag(chunk, "fmt ") && size >= 16) {
+			format = readLE(chunk + 8, 2);
+			channels = readLE(chunk + 10, 2);
+			rate = readLE(chunk + 12, 4);
+			bits = readLE(chunk + 22, 2);
+			if (format == 0xFFFE && size >= 26)	// WAVE_FORMAT_EXTENSIBLE, the sub format starts like a format tag
+				format = readLE(chunk + 32, 2);
+		}
+		else if (hasTag(chunk, "data")) {
+			data = chunk + 8;
+			dataSize = size;
+		}
+		pos += 8 + size + (size & 1);
+	}
+
+	bool pcm = format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+	bool ieee = format == 3 && bits == 32;
+	if (!data || (!pcm && !ieee) || channels < 1 || channels > 2 || rate == 0)
+		return false;
+
+	int bytesPerSample = bits / 8;
+	size_t frames = dataSize / (bytesPerSample * channels);
+	if (frames == 0)
+		return false;
+
+	sound.frames = frames;
+	sound.sampleRate = rate;
+	for (std::vector<float>& samples : sound.channels)
+		samples.assign(frames + 2 * SOUND_PADDING, 0.0f);
+
+	for (size_t f = 0; f < frames; f++) {
+		for (int c = 0; c < MIXER_CHANNELS; c++) {
+			const uint8_t* p = data + (f * channels + (c < channels ? c : 0)) * bytesPerSample;
+			float v;
+			if (ieee) std::copy(p, p + 4, (uint8_t*)&v);	// little-endian like the file
+			else if (bits == 8) v = (p[0] - 128) / 128.0f;
+			else v = (int32_t)(readLE(p, bytesPerSample) << (32 - bits)) / 2147483648.0f;
+			sound.channels[c][SOUND_PADDING + f] = v;
+		}
+	}
+	sound.pad();
+	return true;
+}
+
+
+
+/*************************************************************************************************************
+ Where the mixed blocks go
+**************************************************************************************************************/
+
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() {}
+	virtual bool open(int sampleRate, int channels, int blockFrames) = 0;
+	/* takes one interleaved block, waits until the device has room for it */
+	virtual void write(const float* samples, int frames) = 0;
+	virtual void close() = 0;
+};
+
+/* drops the audio, paced like a real device */
+class NullAudioBackend : public AudioBackend
+{
+public:
+	NullAudioBackend() : sampleRate(MIXER_SAMPLE_RATE) {}
+
+	bool open(int rate, int, int) override {
+		sampleRate = rate;
+		next = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	void write(const float*, int frames) override {
+		next += std::chrono::microseconds((long long)frames * 1000000 / sampleRate);
+		std::this_thread::sleep_until(next);
+	}
+
+	void close() override {}
+
+protected:
+	int sampleRate;
+	std::chrono::steady_clock::time_point next;
+};
+
+/* records the mix into a 16-bit .wav file */
+class FileAudioBackend : public NullAudioBackend
+{
+public:
+	explicit FileAudioBackend(const std::string& filename) : filename(filename), channels(MIXER_CHANNELS), frames(0) {}
+	~FileAudioBackend() { close(); }
+
+	bool open(int rate, int channelCount, int blockFrames) override {
+		NullAudioBackend::open(rate, channelCount, blockFrames);
+		channels = channelCount;
+		frames = 0;
+		file.open(filename, std::ios::binary);
+		writeHeader();
+		return (bool)file;
+	}
+
+	void write(const float* samples, int count) override {
+		for (int i = 0; i < count * channels; i++) {
+			int16_t v = (int16_t)lroundf(samples[i] * 32767.0f);
+			file.write((const char*)&v, 2);
+		}
+		frames += count;
+		NullAudioBackend::write(samples, count);
+	}
+
+	void close() override {
+		if (!file.is_open()) return;
+		file.seekp(0);
+		writeHeader();
+		file.close();
+	}
+
+private:
+	void writeHeader() {
+		uint32_t dataSize = frames * channels * 2;
+		uint32_t riffSize = 36 + dataSize;
+		uint32_t fmtSize = 16, rate = sampleRate, byteRate = sampleRate * channels * 2;
+		uint16_t format = 1, channelCount = channels, blockAlign = channels * 2, bits = 16;
+		file.write("RIFF", 4); file.write((const char*)&riffSize, 4); file.write("WAVE", 4);
+		file.write("fmt ", 4); file.write((const char*)&fmtSize, 4); file.write((const char*)&format, 2);
+		file.write((const char*)&channelCount, 2); file.write((const char*)&rate, 4); file.write((const char*)&byteRate, 4);
+		file.write((const char*)&blockAlign, 2); file.write((const char*)&bits, 2);
+		file.write("data", 4); file.write((const char*)&dataSize, 4);
+	}
+
+	std::string filename;
+	std::ofstream file;
+	int channels;
+	uint32_t frames;
+};
+
+#ifdef _WIN32
+/* a few short waveOut buffers played back to back */
+class WaveOutAudioBackend : public AudioBackend
+{
+public:
+	WaveOutAudioBackend() : device(0), event(0), next(0) {}
+	~WaveOutAudioBackend() { close(); }
+
+	bool open(int sampleRate, int channels, int blockFrames) override {
+		WAVEFORMATEX format = {};
+		format.wFormatTag = WAVE_FORMAT_PCM;
+		format.nChannels = channels;
+		format.nSamplesPerSec = sampleRate;
+		format.wBitsPerSample = 16;
+		format.nBlockAlign = channels * 2;
+		format.nAvgBytesPerSec = sampleRate * format.nBlockAlign;
+
+		event = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (waveOutOpen(&device, WAVE_MAPPER, &format, (DWORD_PTR)event, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+			CloseHandle(event);
+			event = 0;
+			device = 0;
+			return false;
+		}
+
+		for (int i = 0; i < WAVEOUT_BUFFERS; i++) {
+			buffers[i].assign(blockFrames * channels, 0);
+			headers[i] = WAVEHDR{};
+			headers[i].lpData = (LPSTR)buffers[i].data();
+			headers[i].dwBufferLength = (DWORD)(buffers[i].size() * sizeof(int16_t));
+			waveOutPrepareHeader(device, &headers[i], sizeof(WAVEHDR));
+			headers[i].dwFlags |= WHDR_DONE;	// free to fill
+		}
+		return true;
+	}
+
+	void write(const float* samples, int frames) override {
+		WAVEHDR& header = headers[next];
+		while (!(header.dwFlags & WHDR_DONE))
+			WaitForSingleObject(event, 50);
+
+		std::vector<int16_t>& buffer = buffers[next];
+		for (size_t i = 0; i < buffer.size(); i++)
+			buffer[i] = (int16_t)lroundf(samples[i] * 32767.0f);
+
+		header.dwFlags &= ~WHDR_DONE;
+		waveOutWrite(device, &header, sizeof(WAVEHDR));
+		next = (next + 1) % WAVEOUT_BUFFERS;
+	}
+
+	void close() override {
+		if (!device) return;
+		waveOutReset(device);
+		for (int i = 0; i < WAVEOUT_BUFFERS; i++)
+			waveOutUnprepareHeader(device, &headers[i], sizeof(WAVEHDR));
+		waveOutClose(device);
+		CloseHandle(event);
+		device = 0;
+		event = 0;
+	}
+
+private:
+	static const int WAVEOUT_BUFFERS = 4;	// 40 ms queued at most
+
+	HWAVEOUT device;
+	HANDLE event;
+	WAVEHDR headers[WAVEOUT_BUFFERS];
+	std::vector<int16_t> buffers[WAVEOUT_BUFFERS];
+	int next;
+};
+#endif
+
+
+
+/*************************************************************************************************************
+ The mixer
+**************************************************************************************************************/
+
+class AudioMixer
+{
+public:
+	AudioMixer() : resamplers{ Resampler(RESAMPLER_FAST), Resampler(RESAMPLER_MEDIUM), Resampler(RESAMPLER_HIGH) },
+		soundCount(0), nextId(0), quality(RESAMPLER_MEDIUM), running(false), available(false) {
+		for (int i = 0; i < MIXER_SOUNDS; i++) {
+			requested[i] = 0;
+			speeds[i].store(1.0f);
+			ended[i].store(0);
+		}
+		for (Voice& v : voices)
+			v.active = false;
+	}
+
+	~AudioMixer() { close(); }
+
+	/* decodes a sound, must be called before start. Returns its id, or -1 */
+	int load(const char* filename) {
+		if (running || soundCount == MIXER_SOUNDS || !decodeWav(filename, sounds[soundCount]))
+			return -1;
+		return soundCount++;
+	}
+
+	void start(std::unique_ptr<AudioBackend> output) {
+		if (running) return;
+		backend = std::move(output);
+		running = true;
+		available = true;
+		thread = std::thread(&AudioMixer::run, this);
+	}
+
+	/* stops the audio thread and the device */
+	void close() {
+		if (!running) return;
+		running = false;
+		thread.join();
+		available = false;
+	}
+
+	/* restarts the sound if it is already playing. Render thread, like stop: the queue has one producer.
+	   False only if the audio thread is behind: nothing changed, the caller may try again */
+	bool play(int sound, bool loop) {
+		if (!valid(sound)) return true;
+		uint32_t id = nextId + 1;
+		if (!commands.push(Command{ Command::Play, sound, id, loop }))
+			return false;
+		nextId = id;
+		requested[sound] = id;
+		return true;
+	}
+
+	bool stop(int sound) {
+		if (!valid(sound) || requested[sound] == 0) return true;
+		if (!commands.push(Command{ Command::Stop, sound, 0, false }))
+			return false;
+		requested[sound] = 0;
+		return true;
+	}
+
+	void stopAll() {
+		for (int i = 0; i < soundCount; i++)
+			stop(i);
+	}
+
+	/* playback speed of a sound, 1 is its own pitch. Applies to the next block, and to later plays. Any thread */
+	void setSpeed(int sound, float speed) {
+		if (!valid(sound)) return;
+		speed = std::min(std::max(speed, 1.0f / RESAMPLER_MAX_RATIO), RESAMPLER_MAX_RATIO);
+		speeds[sound].store(speed, std::memory_order_relaxed);
+	}
+
+	void setQuality(ResamplerQuality q) {
+		quality.store(q, std::memory_order_relaxed);
+	}
+
+	/* true from play until stop, or until the audio thread reaches the end of a one-shot */
+	bool isPlaying(int sound) const {
+		return valid(sound) && requested[sound] != 0 && ended[sound].load(std::memory_order_acquire) != requested[sound];
+	}
+
+private:
+	struct Command {
+		enum Type { Play, Stop } type;
+		int sound;
+		uint32_t id;
+		bool loop;
+	};
+
+	struct Voice {
+		bool active;
+		bool loop;
+		int sound;
+		uint32_t id;
+		double position;	// in frames of the sound
+	};
+
+	bool valid(int sound) const { return sound >= 0 && sound < soundCount && available; }
+
+	void run() {
+		float block[MIXER_BLOCK_FRAMES * MIXER_CHANNELS];
+		if (!backend->open(MIXER_SAMPLE_RATE, MIXER_CHANNELS, MIXER_BLOCK_FRAMES)) {
+			available = false;
+			return;
+		}
+
+		while (running) {
+			Command command;
+			while (commands.pop(command))
+				handle(command);
+
+			mix(block, MIXER_BLOCK_FRAMES);
+			backend->write(block, MIXER_BLOCK_FRAMES);
+		}
+		backend->close();
+	}
+
+	void handle(const Command& command) {
+		Voice* voice = nullptr;
+		for (Voice& v : voices)
+			if (v.active && v.sound == command.sound)
+				voice = &v;
+
+		if (command.type == Command::Stop) {
+			if (voice) finish(*voice);
+			return;
+		}
+
+		if (!voice) {
+			for (Voice& v : voices)
+				if (!v.active && !voice) voice = &v;
+		}
+		if (!voice) {	// steal the oldest voice
+			voice = &voices[0];
+			for (Voice& v : voices)
+				if (v.id < voice->id) voice = &v;
+			finish(*voice);
+		}
+
+		*voice = Voice{ true, command.loop, command.sound, command.id, 0.0 };
+	}
+
+	void finish(Voice& voice) {
+		voice.active = false;
+		ended[voice.sound].store(voice.id, std::memory_order_release);
+	}
+
+	void mix(float* out, int frames) {
+		std::fill(out, out + frames * MIXER_CHANNELS, 0.0f);
+		const Resampler& resampler = resamplers[quality.load(std::memory_order_relaxed)];
+
+		for (Voice& voice : voices) {
+			if (!voice.active) continue;
+			const DecodedSound& sound = sounds[voice.sound];
+			const float* left = sound.channel(0);
+			const float* right = sound.channel(1);
+			double length = (double)sound.frames;
+			double step = (double)sound.sampleRate / MIXER_SAMPLE_RATE * speeds[voice.sound].load(std::memory_order_relaxed);
+			const float* filter = resampler.filter(step);	// picked once per block
+
+			for (int f = 0; f < frames; f++) {
+				float l, r;
+				resampler.sample(filter, left, right, voice.position, l, r);
+				out[f * 2] += l;
+				out[f * 2 + 1] += r;
+
+				voice.position += step;
+				if (voice.position >= length) {
+					if (!voice.loop) {
+						finish(voice);
+						break;
+					}
+					voice.position = fmod(voice.position, length);
+				}
+			}
+		}
+
+		for (int i = 0; i < frames * MIXER_CHANNELS; i++)
+			out[i] = out[i] > 1.0f ? 1.0f : (out[i] < -1.0f ? -1.0f : out[i]);
+	}
+
+	Resampler resamplers[RESAMPLER_QUALITY_COUNT];
+	DecodedSound sounds[MIXER_SOUNDS];
+	int soundCount;
+
+	// render thread
+	uint32_t requested[MIXER_SOUNDS];	// id of the last play, 0 once stopped
+	uint32_t nextId;
+
+	// any thread
+	std::atomic<float> speeds[MIXER_SOUNDS];
+	std::atomic<int> quality;
+
+	// audio thread
+	Voice voices[MIXER_VOICES];
+	std::atomic<uint32_t> ended[MIXER_SOUNDS];	// id of the last voice that stopped or ran out
+
+	SpscQueue<Command, 64> commands;
+	std::unique_ptr<AudioBackend> backend;
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> available;
+};
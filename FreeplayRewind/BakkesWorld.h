@@ -0,0 +1,257 @@
+#pragma once
+#include "bakkesmod/plugin/bakkesmodplugin.h"
+#include "World.h"
+#include <vector>
+#include <memory>
+
+
+/*************************************************************************************************************
+ The game, through BakkesMod
+**************************************************************************************************************/
+
+/* The game moves every body and runs the jump timers between two ticks, so apply sets all of their fields
+   each time; only what the game cannot change behind apply's back is skipped: the ball is unfrozen only
+   when frozen, and pads, which are learnt through padChanged, only when they differ. The boost component
+   of the car is looked up once per car. Jump timers are only read while the car is in the air after a jump.
+   Rotations are Rotators only for the wrappers, they are quaternions everywhere else. */
+class BakkesWorld : public RewindWorld
+{
+public:
+	BakkesWorld(std::shared_ptr<GameWrapper> gameWrapper, std::shared_ptr<CVarManagerWrapper> cvarManager) : gameWrapper(gameWrapper),
+		game(0), ball(0), car(0), boost(0), boostOwner(0), padsPicked(0),
+		goalCvar(cvarManager->getCvar("sv_freeplay_enablegoal")), goalEnabled(false) {
+		if (goalCvar.IsNull()) return;
+		goalEnabled = goalCvar.getBoolValue();
+		goalCvar.addOnValueChanged([this](std::string, CVarWrapper now) {
+			goalEnabled = now.getBoolValue();
+		});
+	}
+
+	bool refresh() override {
+		game = gameWrapper->GetGameEventAsServer();
+		if (game.IsNull()) return false;
+		ball = game.GetBall();
+		car = game.GetGameCar();
+		calls.reads += 3;
+		if (ball.IsNull() || car.IsNull()) return false;
+
+		if (car.memory_address != boostOwner) {	// only looked up again for another car
+			boost = car.GetBoostComponent();
+			boostOwner = car.memory_address;
+			calls.reads++;
+		}
+
+		otherBalls.clear();
+		otherCars.clear();
+		ArrayWrapper<BallWrapper> balls = game.GetGameBalls();
+		for (int i = 0; i < balls.Count(); i++) {
+			BallWrapper b = balls.Get(i);
+			if (!b.IsNull() && b.memory_address != ball.memory_address) otherBalls.push_back(b);
+		}
+		ArrayWrapper<CarWrapper> cars = game.GetCars();
+		for (int i = 0; i < cars.Count(); i++) {
+			CarWrapper c = cars.Get(i);
+			if (!c.IsNull() && c.memory_address != car.memory_address) otherCars.push_back(c);
+		}
+		calls.reads += 2 + otherBalls.size() + otherCars.size();
+		return true;
+	}
+
+	int otherBodies() override { return (int)(otherBalls.size() + otherCars.size()); }
+
+	float secondsElapsed() override { calls.reads++; return game.GetSecondsElapsed(); }
+	bool isCarMoving() override { calls.reads++; return car.GetbIsMoving(); }
+	ControllerInput carInput() override { calls.reads++; return car.GetInput(); }
+	bool isBallInGoal() override { calls.reads += 2; return game.IsInGoal(ball.GetLocation()); }
+	bool isKeyPressed(int key) override { return gameWrapper->IsKeyPressed(key); }
+	bool isPaused() override { calls.reads++; return gameWrapper->IsPaused(); }
+
+	/* the cvar is looked up once, its value is mirrored by a change callback */
+	void setGoalEnabled(bool enabled) override {
+		if (enabled != goalEnabled && !goalCvar.IsNull()) goalCvar.setValue(enabled);
+	}
+
+	/* boost pads are learnt as they are picked up and respawn, forgetPads when the map changes */
+	void padChanged(VehiclePickupWrapper pad, bool picked) {
+		size_t n = 0;
+		while (n < pads.size() && pads[n].wrapper.memory_address != pad.memory_address) n++;
+		if (n == pads.size()) {
+			if (n == PAD_MAX) return;
+			pads.push_back(Pad{ pad, pad.GetRespawnDelay() });
+			calls.reads++;
+		}
+		if (picked) padsPicked |= 1ull << n;
+		else padsPicked &= ~(1ull << n);
+	}
+
+	void forgetPads() {
+		pads.clear();
+		padsPicked = 0;
+	}
+
+	void capture(WorldState& state) override {
+		BodyState body;
+		captureBody(ball, nullptr, body);
+		state.location[SNAPSHOT_BALL] = body.location;
+		state.velocity[SNAPSHOT_BALL] = body.velocity;
+		state.angularVelocity[SNAPSHOT_BALL] = body.angularVelocity;
+		state.rotation[SNAPSHOT_BALL] = body.rotation;
+
+		captureBody(car, &boost, body);
+		state.location[SNAPSHOT_CAR] = body.location;
+		state.velocity[SNAPSHOT_CAR] = body.velocity;
+		state.angularVelocity[SNAPSHOT_CAR] = body.angularVelocity;
+		state.rotation[SNAPSHOT_CAR] = body.rotation;
+		state.boost = body.boost;
+		captureJump(state.jump);
+		state.pads = PadState();
+		state.pads.picked = padsPicked;
+
+		state.balls.resize(otherBalls.size());
+		for (size_t i = 0; i < otherBalls.size(); i++)
+			captureBody(otherBalls[i], nullptr, state.balls[i]);
+		state.cars.resize(otherCars.size());
+		for (size_t i = 0; i < otherCars.size(); i++) {
+			BoostWrapper b = otherCars[i].GetBoostComponent();
+			calls.reads++;
+			captureBody(otherCars[i], &b, state.cars[i]);
+		}
+	}
+
+	void apply(const WorldState& state) override {
+		BodyState body = BodyState{ state.location[SNAPSHOT_BALL], state.velocity[SNAPSHOT_BALL], state.angularVelocity[SNAPSHOT_BALL],
+			state.rotation[SNAPSHOT_BALL], 0.0f };
+		calls.reads++;
+		if (ball.GetbFrozen()) {	// frozen after a reset until touched
+			ball.SetFrozen(0);
+			calls.writes++;
+		}
+		else calls.skipped++;
+		applyBody(ball, nullptr, body);
+
+		body = BodyState{ state.location[SNAPSHOT_CAR], state.velocity[SNAPSHOT_CAR], state.angularVelocity[SNAPSHOT_CAR],
+			state.rotation[SNAPSHOT_CAR], state.boost };
+		applyBody(car, &boost, body);
+		car.SetDriving(1);
+		calls.writes++;
+		applyJump(state.jump);
+		if (state.pads.known) applyPads(state.pads);
+
+		for (size_t i = 0; i < otherBalls.size() && i < state.balls.size(); i++)
+			applyBody(otherBalls[i], nullptr, state.balls[i]);
+		for (size_t i = 0; i < otherCars.size() && i < state.cars.size(); i++) {
+			BoostWrapper b = otherCars[i].GetBoostComponent();
+			calls.reads++;
+			applyBody(otherCars[i], &b, state.cars[i]);
+		}
+	}
+
+private:
+	static Quaternion toQuaternion(const Rotator& r) { return quaternionFromRotation(r.Pitch, r.Yaw, r.Roll); }
+
+	static Rotator toRotator(const Quaternion& q) {
+		int pitch, yaw, roll;
+		quaternionToRotation(q, pitch, yaw, roll);
+		return Rotator(pitch, yaw, roll);
+	}
+
+	void captureJump(JumpState& jump) {
+		jump = JumpState();
+		jump.jumped = car.GetbJumped() != 0;
+		jump.doubleJumped = car.GetbDoubleJumped() != 0;
+		calls.reads += 2;
+		if (jump.jumped) {
+			JumpComponentWrapper component = car.GetJumpComponent();
+			if (!component.IsNull()) jump.jumpTime = component.GetActivityTime();
+			calls.reads += 2;
+		}
+		if (jump.doubleJumped) {
+			DodgeComponentWrapper component = car.GetDodgeComponent();
+			if (!component.IsNull()) jump.dodgeTime = component.GetActivityTime();
+			calls.reads += 2;
+		}
+	}
+
+	/* restores the flip the car had: its flags, and the timers that tell how long it can still use it */
+	void applyJump(const JumpState& jump) {
+		car.SetbJumped(jump.jumped);
+		car.SetbDoubleJumped(jump.doubleJumped);
+		calls.writes += 2;
+		if (jump.jumped) {
+			JumpComponentWrapper component = car.GetJumpComponent();
+			if (!component.IsNull()) component.SetActivityTime(jump.jumpTime);
+			calls.writes += 2;
+		}
+		if (jump.doubleJumped) {
+			DodgeComponentWrapper component = car.GetDodgeComponent();
+			if (!component.IsNull()) component.SetActivityTime(jump.dodgeTime);
+			calls.writes += 2;
+		}
+	}
+
+	/* a pad that must be down is picked up with what was left of its respawn delay, then the delay is put back */
+	void applyPads(const PadState& state) {
+		for (size_t n = 0; n < pads.size(); n++) {
+			uint64_t bit = 1ull << n;
+			if ((state.picked & bit) == (padsPicked & bit)) {
+				calls.skipped++;
+				continue;
+			}
+
+			VehiclePickupWrapper& pad = pads[n].wrapper;
+			if (state.picked & bit) {
+				float left = pads[n].delay - state.since[n];
+				pad.SetRespawnDelay(left > 0.1f ? left : 0.1f);
+				pad.SetPickedUp(1, PriWrapper(0));
+				pad.SetRespawnDelay(pads[n].delay);
+				calls.writes += 3;
+			}
+			else {
+				pad.Respawn();
+				calls.writes++;
+			}
+			if (state.picked & bit) padsPicked |= bit;
+			else padsPicked &= ~bit;
+		}
+	}
+
+	void captureBody(ActorWrapper actor, BoostWrapper* boostComponent, BodyState& body) {
+		body.location = actor.GetLocation();
+		body.velocity = actor.GetVelocity();
+		body.angularVelocity = actor.GetAngularVelocity();
+		body.rotation = toQuaternion(actor.GetRotation());
+		body.boost = boostComponent && !boostComponent->IsNull() ? boostComponent->GetCurrentBoostAmount() : 0;
+		calls.reads += boostComponent ? 5 : 4;
+	}
+
+	void applyBody(ActorWrapper actor, BoostWrapper* boostComponent, const BodyState& body) {
+		actor.SetLocation(body.location);
+		actor.SetVelocity(body.velocity);
+		actor.SetRotation(toRotator(body.rotation));
+		actor.SetAngularVelocity(body.angularVelocity, 0);
+		calls.writes += 4;
+		if (boostComponent && !boostComponent->IsNull()) {
+			boostComponent->SetBoostAmount(body.boost);
+			calls.writes++;
+		}
+	}
+
+	std::shared_ptr<GameWrapper> gameWrapper;
+	ServerWrapper game;
+	BallWrapper ball;
+	CarWrapper car;
+	BoostWrapper boost;						// of car
+	uintptr_t boostOwner;
+	std::vector<BallWrapper> otherBalls;	// in the order of the server's arrays
+	std::vector<CarWrapper> otherCars;
+
+	struct Pad {
+		VehiclePickupWrapper wrapper;
+		float delay;						// its respawn delay, as the map sets it
+	};
+	std::vector<Pad> pads;					// in the order padChanged first saw them
+	uint64_t padsPicked;					// bit n set while pads[n] is picked up
+
+	CVarWrapper goalCvar;					// sv_freeplay_enablegoal
+	bool goalEnabled;						// its value
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include "SnapshotFrame.h"
+#include "SpscQueue.h"
+#include "EventTrack.h"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ Capture pipeline
+
+ The game thread only reads each raw snapshot into a slot of a lock-free queue, a worker thread drains
+ it and does everything else (decimation, compression, the session file, the fr_stats of the changes). The session file's markers (a new
+ attempt, a clear) go through the same queue, so the worker is the only thread feeding the session
+ writer and they stay in order with the snapshots. While the worker may be running,
+ the history belongs to it: the game thread calls drain() before reading or changing the history,
+ which returns once every submitted capture has been processed. Recording and rewinding never happen
+ at the same time, so drain() only waits for the last few captures.
+ When the worker falls behind, captures are dropped instead of blocking the game thread. The worker is
+ only woken up when it sleeps, it takes every capture queued meanwhile in one go.
+**************************************************************************************************************/
+
+const int CAPTURE_QUEUE_SIZE = 64;	// about 2 s of captures at the default interval
+
+struct Capture {
+	enum Kind { Snapshot, EndAttempt, ClearSession } kind;	// a marker only has its kind set
+	SnapshotFrame frames[SNAPSHOT_MAX_PAGES];	// only the pages of balls and cars are set
+	int balls;		// other balls and cars, see WorldState
+	int cars;
+	JumpState jump;
+	uint64_t pads;	// picked boost pads
+	float timestamp;
+};
+
+class CapturePipeline
+{
+public:
+	typedef std::function<void(const Capture&)> Processor;
+
+	CapturePipeline() : submitted(0), running(false), sleeping(false), processed(0), dropped(0), peak(0) {}
+	~CapturePipeline() { close(); }
+
+	void start(Processor processor) {
+		if (running) return;
+		process = processor;
+		running = true;
+		thread = std::thread(&CapturePipeline::run, this);
+	}
+
+	/* processes what is queued, then stops the worker */
+	void close() {
+		if (!running) return;
+		running = false;
+		wake.notify_one();
+		thread.join();
+	}
+
+	/* game thread, never blocks. The queue slot to fill with the next capture, then submit() it. Null if the
+	   queue is full, the capture is then dropped */
+	Capture* claim() {
+		Capture* capture = running ? queue.claim() : nullptr;
+		if (!capture) dropped.fetch_add(1, std::memory_order_relaxed);
+		return capture;
+	}
+
+	/* game thread, hands the claimed capture over to the worker */
+	void submit() {
+		queue.publish();
+		submitted++;
+
+		uint64_t depth = submitted - processed.load(std::memory_order_relaxed);
+		if (depth > peak.load(std::memory_order_relaxed))
+			peak.store(depth, std::memory_order_relaxed);
+		wakeIfSleeping();
+	}
+
+	/* game thread, queues a marker behind the captures submitted so far. Markers are rare and must not be
+	   lost, so it waits for a free slot instead of dropping it */
+	void mark(Capture::Kind kind) {
+		if (!running) return;
+		Capture marker;
+		marker.kind = kind;
+		while (!queue.push(marker)) {
+			wake.notify_one();
+			std::this_thread::yield();
+		}
+		submitted++;
+		wakeIfSleeping();
+	}
+
+	/* game thread, waits until the worker has processed every capture. Its changes are then visible */
+	void drain() {
+		while (processed.load(std::memory_order_acquire) != submitted) {
+			wake.notify_one();	// the worker may have missed a wake-up
+			std::this_thread::yield();
+		}
+	}
+
+	uint64_t submittedCount() const { return submitted; }
+	uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+	uint64_t peakDepth() const { return peak.load(std::memory_order_relaxed); }
+
+	void resetPeak() { peak.store(0, std::memory_order_relaxed); }
+
+private:
+	/* the queue was pushed to before sleeping is read, and the worker sets sleeping before it looks at the
+	   queue, so one of them sees the other. The wait times out anyway */
+	void wakeIfSleeping() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleeping.load(std::memory_order_relaxed))
+			wake.notify_one();
+	}
+
+	void run() {
+		for (;;) {
+			bool stopping = !running;
+			while (const Capture* capture = queue.front()) {
+				process(*capture);
+				queue.release();
+				processed.fetch_add(1, std::memory_order_release);
+			}
+			if (stopping) return;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			wake.wait_for(lock, std::chrono::milliseconds(10), [this] { return !queue.empty() || !running; });
+			sleeping.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	Processor process;
+	SpscQueue<Capture, CAPTURE_QUEUE_SIZE> queue;
+	uint64_t submitted;		// game thread
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::atomic<bool> running;
+	std::atomic<bool> sleeping;		// the worker waits for a wake-up
+	std::atomic<uint64_t> processed;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> peak;
+};
@@ -0,0 +1,268 @@
+#pragma once
+#include "SnapshotFrame.h"
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cmath>
+
+
+/*************************************************************************************************************
+ Quantized, delta-encoded rewind history
+
+ Snapshots are grouped in blocks of COMPRESSED_BLOCK_FRAMES. The first snapshot of a block is a keyframe
+ holding absolute fixed-point values, the others only hold the difference to the previous snapshot, all
+ written as zigzag varints.
+ The block being recorded is also kept decoded, and the last two blocks read are cached decoded, so
+ scrubbing only decodes a block when crossing into it. Every page of a snapshot is encoded with the
+ same lanes, one after the other.
+**************************************************************************************************************/
+
+const int COMPRESSED_BLOCK_FRAMES = 16;
+
+struct QuantizedLane {
+	int channel;	// 0 location, 1 velocity, 2 angular velocity, 3 rotation
+	int lane;
+	float scale;	// fixed-point steps per unit
+	float limit;	// values are clamped to +/- limit
+};
+
+/* the lanes of a SnapshotFrame that carry data, the boost lane is 0 for a page of two balls */
+constexpr QuantizedLane QUANTIZED_LANES[] = {
+	// locations: 0.1 uu within the arena, goals included
+	{ 0, 0, 10.0f, 4200.0f }, { 0, 1, 10.0f, 6100.0f }, { 0, 2, 10.0f, 2100.0f },
+	{ 0, 4, 10.0f, 4200.0f }, { 0, 5, 10.0f, 6100.0f }, { 0, 6, 10.0f, 2100.0f },
+	// velocities: 1 uu/s
+	{ 1, 0, 1.0f, 6000.0f }, { 1, 1, 1.0f, 6000.0f }, { 1, 2, 1.0f, 6000.0f },
+	{ 1, 4, 1.0f, 6000.0f }, { 1, 5, 1.0f, 6000.0f }, { 1, 6, 1.0f, 6000.0f },
+	// angular velocities: 1 mrad/s, then the car's boost
+	{ 2, 0, 1000.0f, 6.0f }, { 2, 1, 1000.0f, 6.0f }, { 2, 2, 1000.0f, 6.0f },
+	{ 2, 4, 1000.0f, 6.0f }, { 2, 5, 1000.0f, 6.0f }, { 2, 6, 1000.0f, 6.0f },
+	{ 2, 7, 1000.0f, 100.0f },
+	// rotations: quaternion components in 1/16384 steps, about 0.01 degree
+	{ 3, 0, 16384.0f, 1.0f }, { 3, 1, 16384.0f, 1.0f }, { 3, 2, 16384.0f, 1.0f }, { 3, 3, 16384.0f, 1.0f },
+	{ 3, 4, 16384.0f, 1.0f }, { 3, 5, 16384.0f, 1.0f }, { 3, 6, 16384.0f, 1.0f }, { 3, 7, 16384.0f, 1.0f },
+};
+
+const int QUANTIZED_LANE_COUNT = sizeof(QUANTIZED_LANES) / sizeof(QuantizedLane);
+
+inline float* channelOf(SnapshotFrame& frame, int channel) {
+	SnapshotChannel* channels[] = { &frame.location, &frame.velocity, &frame.angularVelocity, &frame.rotation };
+	return channels[channel]->v;
+}
+
+inline const float* channelOf(const SnapshotFrame& frame, int channel) {
+	return channelOf(const_cast<SnapshotFrame&>(frame), channel);
+}
+
+/* rounds to the nearest step (ties to even), inline instead of a call to lroundf */
+inline int32_t quantizeLane(const QuantizedLane& q, float value) {
+	if (value > q.limit) value = q.limit;
+	else if (value < -q.limit) value = -q.limit;
+	return _mm_cvt_ss2si(_mm_set_ss(value * q.scale));
+}
+
+inline void writeVarint(std::vector<uint8_t>& out, int32_t value) {
+	uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	while (zigzag >= 0x80) {
+		out.push_back((uint8_t)(zigzag | 0x80));
+		zigzag >>= 7;
+	}
+	out.push_back((uint8_t)zigzag);
+}
+
+/* bytes writeVarint takes for value */
+inline int varintBytes(int32_t value) {
+	uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	int bytes = 1;
+	for (; zigzag >= 0x80; zigzag >>= 7) bytes++;
+	return bytes;
+}
+
+inline int32_t readVarint(const uint8_t*& in) {
+	uint32_t zigzag = 0;
+	int shift = 0;
+	uint8_t b;
+	do {
+		b = *in++;
+		zigzag |= (uint32_t)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+
+class CompressedHistory
+{
+public:
+	CompressedHistory() : budget(0), sealedBytes(0), firstBlock(0), pages(0), tailCount(0), lastCacheSlot(0) {
+		setPages(1);
+	}
+
+	/* bytes used by the sealed blocks plus the decode buffers */
+	size_t memoryUsage() const {
+		return sealedBytes + sizeof(*this) + tailBytes.capacity()
+			+ (tailFrames.capacity() + cache[0].frames.capacity() + cache[1].frames.capacity()) * sizeof(SnapshotFrame);
+	}
+
+	/* clears the history if the number of pages changes */
+	void setPages(int count) {
+		if (count == pageCount()) return;
+		clear();
+		pages = count;
+		tailBytes.reserve(COMPRESSED_BLOCK_FRAMES * QUANTIZED_LANE_COUNT * pages * 5);
+		previous.assign(QUANTIZED_LANE_COUNT * pages, 0);
+		std::vector<SnapshotFrame>(COMPRESSED_BLOCK_FRAMES * pages).swap(tailFrames);	// gives back the memory of more pages
+		std::vector<SnapshotFrame>(COMPRESSED_BLOCK_FRAMES * pages).swap(cache[0].frames);
+		std::vector<SnapshotFrame>(COMPRESSED_BLOCK_FRAMES * pages).swap(cache[1].frames);
+		evict();
+	}
+
+	int pageCount() const { return pages; }
+
+	void setBudget(size_t bytes) {
+		budget = bytes;
+		evict();
+	}
+
+	size_t size() const { return sealed.size() * COMPRESSED_BLOCK_FRAMES + tailCount; }
+
+	/* more snapshots than the budget can ever hold: every lane takes at least a byte */
+	size_t capacityBound() const {
+		return (budget / (QUANTIZED_LANE_COUNT * pages) / COMPRESSED_BLOCK_FRAMES + 2) * COMPRESSED_BLOCK_FRAMES;
+	}
+
+	bool empty() const { return size() == 0; }
+
+	void clear() {
+		sealed.clear();
+		sealedBytes = 0;
+		tailBytes.clear();
+		tailCount = 0;
+		cache[0].block = cache[1].block = -1;
+	}
+
+	/* frames holds one frame per page */
+	void push_back(const SnapshotFrame* frames, float timestamp) {
+		for (int page = 0; page < pages; page++) {
+			SnapshotFrame& decoded = tailFrames[tailCount * pages + page];
+			decoded = SnapshotFrame();
+
+			for (int i = 0; i < QUANTIZED_LANE_COUNT; i++) {
+				const QuantizedLane& q = QUANTIZED_LANES[i];
+				float value = channelOf(frames[page], q.channel)[q.lane];
+				int32_t quantized = quantizeLane(q, value);
+				int32_t& last = previous[page * QUANTIZED_LANE_COUNT + i];
+
+				if (tailCount == 0) writeVarint(tailBytes, quantized);
+				else writeVarint(tailBytes, quantized - last);
+
+				last = quantized;
+				channelOf(decoded, q.channel)[q.lane] = quantized / q.scale;	// what a decode will give back
+			}
+		}
+
+		tailTimestamps[tailCount] = timestamp;
+		if (++tailCount == COMPRESSED_BLOCK_FRAMES)
+			seal();
+	}
+
+	SnapshotView view(size_t i, int page) const {
+		size_t block = i / COMPRESSED_BLOCK_FRAMES;
+		size_t frame = (i % COMPRESSED_BLOCK_FRAMES) * pages + page;
+		if (block == sealed.size())
+			return SnapshotView::of(tailFrames[frame]);
+		return SnapshotView::of(decodedBlock(block)[frame]);
+	}
+
+	float& timestamp(size_t i) {
+		size_t block = i / COMPRESSED_BLOCK_FRAMES;
+		if (block == sealed.size())
+			return tailTimestamps[i % COMPRESSED_BLOCK_FRAMES];
+		return sealed[block].timestamps[i % COMPRESSED_BLOCK_FRAMES];
+	}
+
+	float timestamp(size_t i) const {
+		return const_cast<CompressedHistory*>(this)->timestamp(i);
+	}
+
+private:
+	struct Block {
+		std::vector<uint8_t> bytes;
+		float timestamps[COMPRESSED_BLOCK_FRAMES];
+	};
+
+	struct DecodedBlock {
+		long long block;	// absolute block number, -1 if empty
+		std::vector<SnapshotFrame> frames;	// snapshot by snapshot, page by page
+	};
+
+	/* moves the full tail into an exact-size block and drops the oldest blocks over budget */
+	void seal() {
+		sealed.emplace_back();
+		Block& block = sealed.back();
+		block.bytes.assign(tailBytes.begin(), tailBytes.end());
+		std::copy(tailTimestamps, tailTimestamps + COMPRESSED_BLOCK_FRAMES, block.timestamps);
+		sealedBytes += block.bytes.size() + sizeof(Block);
+
+		tailBytes.clear();
+		tailCount = 0;
+		evict();
+	}
+
+	/* only the sealed blocks count against the budget, the decode buffers are a fixed cost of the page count
+	   which would otherwise leave no history to a few cars under a small budget */
+	void evict() {
+		while (!sealed.empty() && sealedBytes > budget) {
+			sealedBytes -= sealed.front().bytes.size() + sizeof(Block);
+			sealed.pop_front();
+			firstBlock++;
+		}
+	}
+
+	const SnapshotFrame* decodedBlock(size_t block) const {
+		long long id = firstBlock + (long long)block;
+		for (int slot = 0; slot < 2; slot++) {
+			if (cache[slot].block == id) {
+				lastCacheSlot = slot;
+				return cache[slot].frames.data();
+			}
+		}
+
+		// replace the slot that was not used last
+		int slot = 1 - lastCacheSlot;
+		lastCacheSlot = slot;
+		DecodedBlock& decoded = cache[slot];
+		decoded.block = id;
+
+		int32_t values[QUANTIZED_LANE_COUNT * SNAPSHOT_MAX_PAGES];
+		const uint8_t* in = sealed[block].bytes.data();
+		for (int f = 0; f < COMPRESSED_BLOCK_FRAMES * pages; f++) {
+			SnapshotFrame& frame = decoded.frames[f];
+			int32_t* lanes = values + (f % pages) * QUANTIZED_LANE_COUNT;
+			frame = SnapshotFrame();
+			for (int i = 0; i < QUANTIZED_LANE_COUNT; i++) {
+				const QuantizedLane& q = QUANTIZED_LANES[i];
+				int32_t value = readVarint(in);
+				if (f < pages) lanes[i] = value;
+				else lanes[i] += value;
+				channelOf(frame, q.channel)[q.lane] = lanes[i] / q.scale;
+			}
+		}
+		return decoded.frames.data();
+	}
+
+	size_t budget;
+	std::deque<Block> sealed;
+	size_t sealedBytes;
+	long long firstBlock;	// absolute number of sealed.front(), keeps the cache valid across evictions
+
+	int pages;
+	std::vector<SnapshotFrame> tailFrames;	// snapshot by snapshot, page by page
+	float tailTimestamps[COMPRESSED_BLOCK_FRAMES];
+	std::vector<uint8_t> tailBytes;
+	std::vector<int32_t> previous;			// page by page
+	int tailCount;
+
+	mutable DecodedBlock cache[2];
+	mutable int lastCacheSlot;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ State that rarely changes, stored as change events instead of in every snapshot
+
+ An EventTrack holds the value of some state from a store index on, with the time it was recorded at.
+ The value at a snapshot is the last event at or before its store index, found by a binary search.
+ The history records an event when the value changes and at the first snapshot of every branch, so
+ the event found always belongs to the branch of that snapshot.
+**************************************************************************************************************/
+
+/* the car's jump and dodge, its timers run while the flag is set */
+struct JumpState {
+	bool jumped;
+	bool doubleJumped;		// or dodged
+	float jumpTime;			// activity time of the jump component
+	float dodgeTime;		// activity time of the dodge component
+
+	/* a new event is needed unless the timers just ran since */
+	bool follows(const JumpState& earlier, float elapsed) const {
+		return jumped == earlier.jumped && doubleJumped == earlier.doubleJumped
+			&& (!jumped || fabsf(earlier.jumpTime + elapsed - jumpTime) < 0.05f)
+			&& (!doubleJumped || fabsf(earlier.dodgeTime + elapsed - dodgeTime) < 0.05f);
+	}
+
+	void advance(float elapsed) {
+		if (jumped) jumpTime += elapsed;
+		if (doubleJumped) dodgeTime += elapsed;
+	}
+};
+
+const int PAD_MAX = 64;
+
+/* boost pads, numbered in the order the world first saw them */
+struct PadState {
+	bool known;					// false when nothing was recorded, the pads are then left alone
+	uint64_t picked;			// bit n set while pad n is picked up
+	float since[PAD_MAX];		// seconds since pad n was picked up
+};
+
+
+template <typename T>
+class EventTrack
+{
+public:
+	struct Event {
+		uint64_t at;	// store index of the first snapshot it holds for
+		float time;		// that snapshot's timestamp, without the branch offset
+		T value;
+	};
+
+	void clear() { events.clear(); }
+	bool empty() const { return events.empty(); }
+	const Event& back() const { return events.back(); }
+	size_t memoryUsage() const { return events.capacity() * sizeof(Event); }
+
+	void record(uint64_t at, float time, const T& value) {
+		if (!events.empty() && events.back().at == at) events.back() = Event{ at, time, value };
+		else events.push_back(Event{ at, time, value });
+	}
+
+	/* the event holding at store index at, nullptr if there is none */
+	const Event* find(uint64_t at) const {
+		auto after = std::upper_bound(events.begin(), events.end(), at, [](uint64_t i, const Event& e) { return i < e.at; });
+		return after == events.begin() ? nullptr : &*(after - 1);
+	}
+
+	/* drops the events replaced by another one before the oldest stored snapshot */
+	void trim(uint64_t oldest) {
+		size_t n = 0;
+		while (n + 1 < events.size() && events[n + 1].at <= oldest) n++;
+		if (n > 0) events.erase(events.begin(), events.begin() + n);
+	}
+
+private:
+	std::vector<Event> events;
+};
@@ -1,6 +1,10 @@
 #include "FreeplayRewind.h"
+#include "RewindEngine.h"
+#include "Profiler.h"
+#include "AudioMixer.h"
+#include "ShotLibrary.h"
+#include "TripleBuffer.h"
 #include "utils/parser.h"
-#include "utils/customrotator.h"
 #include <iostream>  
 #include <windows.h>
 #include <MMSystem.h>
@@ -11,191 +15,69 @@ BAKKESMOD_PLUGIN(FreeplayRewind, "Freeplay Rewind", "1.2", PLUGINTYPE_FREEPLAY)
 
 
 
-float snapshot_interval = 0.030f; // time between updates in seconds
+Profiler profiler;					// per-hook timings, fr_stats
+RewindEngine engine;				// records and rewinds the game
+Overlay overlay;					// draws the published frames, render thread
 
-/************************************************************************************************************
- Class for saving game states and rewinding
-**************************************************************************************************************/
-
-class GameState
-{
-public:
-	Vector ball_location;
-	Vector car_location;
-	Vector ball_velocity;
-	Vector car_velocity;
-	CustomRotator ball_rotation;
-	CustomRotator car_rotation;
-	Vector ball_ang_velocity;
-	Vector car_ang_velocity;
-	float boost_amount;
-	float timestamp;
-
-	const GameState& operator=(const GameState& other) {
-		ball_location = other.ball_location;
-		car_location = other.car_location;
-		ball_velocity = other.ball_velocity;
-		car_velocity = other.car_velocity;
-		CustomRotator r1 = other.ball_rotation;
-		CustomRotator r2 = other.car_rotation;
-		ball_rotation = r1;
-		car_rotation = r2;
-		ball_ang_velocity = other.ball_ang_velocity;
-		car_ang_velocity = other.car_ang_velocity;
-		boost_amount = other.boost_amount;
-		timestamp = other.timestamp;
-		return *this;
-	}
-
-	GameState() {
-		ball_location = Vector(0, 0, 0);
-		car_location = Vector(0, 0, 0);
-		ball_velocity = Vector(0, 0, 0);
-		car_velocity = Vector(0, 0, 0);
-		Rotator ballRotator = Rotator(0, 0, 0);
-		Rotator carRotator = Rotator(0, 0, 0);
-		ball_rotation = ballRotator;
-		car_rotation = carRotator;
-		ball_ang_velocity = Vector(0, 0, 0);
-		car_ang_velocity = Vector(0, 0, 0);
-		boost_amount = 0;
-		timestamp = 0;
-	}
-
-	GameState(ServerWrapper tw, float ts) {
-		BallWrapper b = tw.GetBall();
-		CarWrapper c = tw.GetGameCar();
-		ball_location = b.GetLocation();
-		car_location = c.GetLocation();
-		ball_velocity = b.GetVelocity();
-		car_velocity = c.GetVelocity();
-		Rotator ballRotator = Rotator(b.GetRotation());
-		Rotator carRotator = Rotator(c.GetRotation());
-		ball_rotation = ballRotator;
-		car_rotation = carRotator;
-		ball_ang_velocity = b.GetAngularVelocity();
-		car_ang_velocity = c.GetAngularVelocity();
-		boost_amount = c.GetBoostComponent().IsNull() ? 0 : c.GetBoostComponent().GetCurrentBoostAmount();
-		timestamp = ts;
-	}
+const char* const SESSION_FILE = ".\\bakkesmod\\data\\freeplayrewind.session";	// engine.session writes it
+SessionMapping sessionMapping;		// the session file as loaded by fr_session_load
 
-	/* for rewinding, interpolate between two instants */
-	void interpolate(GameState lhs, GameState rhs, float elapsed) {
-		float custom_elapsed = elapsed * 1000; 
-		float intval = snapshot_interval * 1000; 
-		Vector snap = Vector(intval);
-		Rotator rotator = Rotator(intval);
-		CustomRotator snapR = CustomRotator(rotator);
-		ball_location = lhs.ball_location + (((rhs.ball_location - lhs.ball_location) / snap) * custom_elapsed);
-		car_location = lhs.car_location + (((rhs.car_location - lhs.car_location) / snap) * custom_elapsed);
-		ball_velocity = lhs.ball_velocity + (((rhs.ball_velocity - lhs.ball_velocity) / snap) * custom_elapsed);
-		car_velocity = lhs.car_velocity + (((rhs.car_velocity - lhs.car_velocity) / snap) * custom_elapsed);
-		//ball_rotation = lhs.ball_rotation + (((rhs.ball_rotation - lhs.ball_rotation) / snapR) * custom_elapsed);
-		CustomRotator brot1 = (lhs.ball_rotation.diffTo(rhs.ball_rotation));
-		CustomRotator brot2 = brot1 / snapR;
-		CustomRotator brot3 = brot2 * CustomRotator(custom_elapsed);
-		ball_rotation = lhs.ball_rotation + brot3;// (((rhs.car_rotation - lhs.car_rotation) / snapR) * custom_elapsed);
-		float difd = (rhs.car_rotation.Pitch._value - lhs.car_rotation.Pitch._value);
-		CustomRotator rot1 = (lhs.car_rotation.diffTo(rhs.car_rotation));
-		CustomRotator rot2 = rot1 / snapR;
-		CustomRotator rot3 = rot2 * CustomRotator(custom_elapsed);
-		car_rotation = lhs.car_rotation + rot3;// (((rhs.car_rotation - lhs.car_rotation) / snapR) * custom_elapsed);
-		ball_ang_velocity = lhs.ball_ang_velocity + (((rhs.ball_ang_velocity - lhs.ball_ang_velocity) / snap) * custom_elapsed);
-		car_ang_velocity = lhs.car_ang_velocity + (((rhs.car_ang_velocity - lhs.car_ang_velocity) / snap) * custom_elapsed);
-		boost_amount = lhs.boost_amount + (((rhs.boost_amount - lhs.boost_amount) / intval) * custom_elapsed);
-	}
-
-	void apply(ServerWrapper tw) {
-		if (tw.IsNull()) return;
-		BallWrapper b = tw.GetBall();
-		CarWrapper c = tw.GetGameCar();
-		if (b.IsNull() || c.IsNull()) return;
-
-		b.SetFrozen(0);
-		b.SetLocation(ball_location);
-		c.SetLocation(car_location);
-		b.SetVelocity(ball_velocity);
-		c.SetVelocity(car_velocity);
-		b.SetRotation(ball_rotation.ToRotator());
-		c.SetRotation(car_rotation.ToRotator());
-		b.SetAngularVelocity(ball_ang_velocity, 0);
-		c.SetAngularVelocity(car_ang_velocity, 0);
-		BoostWrapper boost = c.GetBoostComponent();
-		if (!boost.IsNull()) boost.SetBoostAmount(boost_amount);
-		c.SetbJumped(0);
-		c.SetbDoubleJumped(0);
-		c.SetDriving(1);
-	}
-};
+ShotLibrary shots(".\\bakkesmod\\data\\freeplayrewind.shots");	// fr_shot_save, fr_shot_load
 
 
 
 
 /*************************************************************************************************************
- Class for loading and playing .wav sounds on Windows
+ Sounds, decoded once and played by the mixer's audio thread
 **************************************************************************************************************/
 
+AudioMixer mixer;
+
+/* a sound of the mixer, triggered stays set until reset so a cue plays once per state */
 class Wave {
 
 public:
-	Wave(const char filename[]) {
-		loaded = false;
-		playing = false;
-		buffer = 0;
-		HInstance = GetModuleHandle(0);
-		load(filename);
-	}
-
 	Wave() {
-		loaded = false;
-		playing = false;
-		buffer = 0;
-		HInstance = GetModuleHandle(0);
+		sound = -1;
+		triggered = false;
 	}
 
 	void load(const char filename[]) {
-		ifstream file(filename, ios::binary);
-		if (!file) return;
-
-		file.seekg(0, ios::end);		// get length of file
-		int length = file.tellg();
-		buffer = new char[length];		// allocate memory
-		file.seekg(0, ios::beg);		// position to start of file
-		file.read(buffer, length);		// read entire file into buffer
+		sound = mixer.load(filename);
+	}
 
-		file.close();
-		loaded = true;
+	/* stays untriggered if the mixer's queue was full, so the next frame tries again */
+	void play(bool loop) {
+		triggered = mixer.play(sound, loop);
 	}
 
-	void play(bool async, bool loop) {
-		if (!loaded) return;
+	void stop() {
+		mixer.stop(sound);
+		triggered = false;
+	}
 
-		if (loop)
-			playing = PlaySound(buffer, HInstance, SND_MEMORY | (async ? SND_ASYNC : SND_SYNC) | SND_LOOP | SND_NODEFAULT);
-		else
-			playing = PlaySound(buffer, HInstance, SND_MEMORY | (async ? SND_ASYNC : SND_SYNC | SND_NODEFAULT));
+	void setSpeed(float speed) {
+		mixer.setSpeed(sound, speed);
 	}
 
+	/* what the audio thread is actually playing */
 	bool isPlaying() {
-		return playing;
+		return mixer.isPlaying(sound);
 	}
 
-	void setPlaying(bool b) {
-		playing = b;
+	bool isTriggered() {
+		return triggered;
+	}
+
+	void setTriggered(bool b) {
+		triggered = b;
 	}
 
 private:
-	char* buffer;
-	HINSTANCE HInstance;
-	bool loaded;
-	bool playing;
+	int sound;
+	bool triggered;
 };
 
-/* Returns a random number between min and max */
-int randomnb(int min, int max) {
-	return (rand() % (max + 1 - min)) + min;
-}
-
 string str(float f) {
 	return to_string(f);
 }
@@ -208,58 +90,17 @@ string str(float f) {
 **************************************************************************************************************/
 
 void FreeplayRewind::onLoad() {
-	initVariables();
+	world = std::make_shared<BakkesWorld>(gameWrapper, cvarManager);
 	initKeys();
 	initSounds();
 	registerCvars();
 	onValuesChanged();
 	registerNotifiers();
+	engine.start();
 	hookEvents();
 }
 
 
-void FreeplayRewind::initVariables() {
-	fr_enabled = std::make_shared<bool>(false);
-
-	/* rewind settings */
-	fr_rewind_backwardSound = std::make_shared<bool>(false);
-	fr_rewind_forwardSound = std::make_shared<bool>(false);
-	fr_rewind_pauseSound = std::make_shared<bool>(false);
-	fr_rewind_playSound = std::make_shared<bool>(false);
-	fr_rewind_maxHistory = std::make_shared<int>(0);
-	fr_rewind_backwardSpeed = std::make_shared<float>(0.0f);
-	fr_rewind_forwardSpeed = std::make_shared<float>(0.0f);
-	fr_rewind_deadzone = std::make_shared<float>(0.0f);
-
-	/* filter settings */
-	fr_filter_show = std::make_shared<bool>(false);
-	fr_filter_rewindLines = std::make_shared<bool>(false);
-	fr_filter_opacity = std::make_shared<int>(0);
-	fr_filter_fadeSpeed = std::make_shared<int>(0);
-	fr_filter_shake = std::make_shared<int>(0);
-
-	/* icons settings */
-	fr_icons_show = std::make_shared<bool>(true);
-	fr_icons_autoHide = std::make_shared<bool>(false);
-	fr_icons_fixedPosition = std::make_shared<bool>(false);
-	fr_icons_shake = std::make_shared<bool>(false);
-	fr_icons_guidelines = std::make_shared<bool>(false);
-	fr_icons_positionX = std::make_shared<int>(0);
-	fr_icons_positionY = std::make_shared<int>(0);
-	fr_icons_size = std::make_shared<float>(0.0f);
-
-	/* color settings */
-	fr_color_element = std::make_shared<string>("");
-	fr_color_elementR = std::make_shared<int>(0);
-	fr_color_elementG = std::make_shared<int>(0);
-	fr_color_elementB = std::make_shared<int>(0);
-
-	// extra settings
-	fr_replay_enabled = std::make_shared<bool>(false);
-	fr_switchpov_enabled = std::make_shared<bool>(false);
-}
-
-
 vector<KEY> keyboardAndMouseKeys, controllerKeys;
 void FreeplayRewind::initKeys() {
 	for (KEY k : {
@@ -308,81 +149,47 @@ void FreeplayRewind::initSounds() {
 	playSound.load(".\\bakkesmod\\data\\play.wav");
 	backwardSound.load(".\\bakkesmod\\data\\backward.wav");
 	forwardSound.load(".\\bakkesmod\\data\\forward.wav");
+
+#ifdef _WIN32
+	mixer.start(std::unique_ptr<AudioBackend>(new WaveOutAudioBackend()));
+#else
+	mixer.start(std::unique_ptr<AudioBackend>(new NullAudioBackend()));
+#endif
 }
 
 
+/* copies the value of a cvar into its Settings member */
+static void readSetting(Settings& settings, const SettingInfo& info, CVarWrapper cvar) {
+	switch (info.type) {
+	case SettingType::Bool:		if (info.boolMember) settings.*info.boolMember = cvar.getBoolValue(); break;
+	case SettingType::Int:		if (info.intMember) settings.*info.intMember = cvar.getIntValue(); break;
+	case SettingType::Float:	if (info.floatMember) settings.*info.floatMember = cvar.getFloatValue(); break;
+	case SettingType::String:	if (info.stringMember) settings.*info.stringMember = cvar.getStringValue(); break;
+	}
+}
+
 void FreeplayRewind::registerCvars() {
-	/* Enable plugin and rewind button/key */
-	cvarManager->registerCvar("fr_enabled", "1", "", false, true, 0, true, 1, true).bindTo(fr_enabled);
-	cvarManager->registerCvar("fr_rewindKeyController", "XboxTypeS_LeftShoulder", "", false, false, 0.0f, false, 1.0f, true);
-	cvarManager->registerCvar("fr_rewindKeyKBM", "R", "", false, false, 0.0f, false, 1.0f, true);
-	cvarManager->registerCvar("fr_bindKeyStatus", "Click here to quickly bind your rewind button/key", "", false, false, 0.0f, false, 1.0f, false);
-
-	/* rewind settings */
-	cvarManager->registerCvar("fr_rewind_backwardSound", "1", "", false, true, 0, true, 1, true).bindTo(fr_rewind_backwardSound);
-	cvarManager->registerCvar("fr_rewind_forwardSound", "1", "", false, true, 0, true, 1, true).bindTo(fr_rewind_forwardSound);
-	cvarManager->registerCvar("fr_rewind_pauseSound", "1", "", false, true, 0, true, 1, true).bindTo(fr_rewind_pauseSound);
-	cvarManager->registerCvar("fr_rewind_playSound", "1", "", false, true, 0, true, 1, true).bindTo(fr_rewind_playSound);
-	cvarManager->registerCvar("fr_rewind_maxHistory", "375", "", false, true, 100, true, 1000, true).bindTo(fr_rewind_maxHistory);
-	cvarManager->registerCvar("fr_rewind_backwardSpeed", "3.0", "", false, true, 1.0f, true, 7.0f, true).bindTo(fr_rewind_backwardSpeed);
-	cvarManager->registerCvar("fr_rewind_forwardSpeed", "2.5", "", false, true, 1.0f, true, 7.0f, true).bindTo(fr_rewind_forwardSpeed);
-	cvarManager->registerCvar("fr_rewind_deadzone", "0.05", "", false, true, 0.01f, true, 0.50f, true).bindTo(fr_rewind_deadzone); // idk
-
-	/* filter settings */
-	cvarManager->registerCvar("fr_filter_show", "1", "", false, true, 0, true, 1, true).bindTo(fr_filter_show);
-	cvarManager->registerCvar("fr_filter_rewindLines", "1", "", false, true, 0, true, 1, true).bindTo(fr_filter_rewindLines);
-	cvarManager->registerCvar("fr_filter_opacity", "60", "", false, true, 0, true, 110, true).bindTo(fr_filter_opacity);
-	cvarManager->registerCvar("fr_filter_fadeSpeed", "15", "", false, true, 1, true, 100, true).bindTo(fr_filter_fadeSpeed);
-	cvarManager->registerCvar("fr_filter_shake", "25", "", false, true, 0, true, 100, true).bindTo(fr_filter_shake);
-
-	/* icons settings */
-	cvarManager->registerCvar("fr_icons_show", "1", "", false, true, 0, true, 1, true).bindTo(fr_icons_show);
-	cvarManager->registerCvar("fr_icons_autoHide", "1", "", false, true, 0, true, 1, true).bindTo(fr_icons_autoHide);
-	cvarManager->registerCvar("fr_icons_fixedPosition", "1", "", false, true, 0, true, 1, true).bindTo(fr_icons_fixedPosition);
-	cvarManager->registerCvar("fr_icons_shake", "1", "", false, true, 0, true, 1, true).bindTo(fr_icons_shake);
-	cvarManager->registerCvar("fr_icons_guidelines", "0", "", false, true, 0, true, 1, true).bindTo(fr_icons_guidelines);
-	cvarManager->registerCvar("fr_icons_positionX", "83", "", false, true, 0, true, 100, true).bindTo(fr_icons_positionX); // here
-	cvarManager->registerCvar("fr_icons_positionY", "13", "", false, true, 0, true, 100, true).bindTo(fr_icons_positionY);// here
-	cvarManager->registerCvar("fr_icons_size", "1.8", "", false, true, 0.3, true, 3.0f, true).bindTo(fr_icons_size); // here
-
-	/* color settings */
-	cvarManager->registerCvar("fr_color_element", "Filter", "", false, false, 0, false, 0, false).bindTo(fr_color_element);
-	cvarManager->registerCvar("fr_color_elementR", "0", "", false, true, 0, true, 255, false).bindTo(fr_color_elementR);
-	cvarManager->registerCvar("fr_color_elementG", "0", "", false, true, 0, true, 255, false).bindTo(fr_color_elementG);
-	cvarManager->registerCvar("fr_color_elementB", "0", "", false, true, 0, true, 255, false).bindTo(fr_color_elementB);
-
-	// Icons RGB values
-	cvarManager->registerCvar("fr_color_filterR", "130", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_filterG", "80", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_filterB", "15", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_playR", "220", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_playG", "210", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_playB", "190", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_shadowR", "60", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_shadowG", "60", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_shadowB", "60", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_backwardActiveR", "220", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_backwardActiveG", "210", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_backwardActiveB", "190", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_backwardInactiveR", "185", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_backwardInactiveG", "180", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_backwardInactiveB", "175", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_forwardActiveR", "220", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_forwardActiveG", "210", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_forwardActiveB", "190", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_forwardInactiveR", "185", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_forwardInactiveG", "180", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_forwardInactiveB", "175", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_pauseActiveR", "220", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_pauseActiveG", "210", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_pauseActiveB", "190", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_pauseInactiveR", "185", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_pauseInactiveG", "180", "", false, true, 0, true, 255, true);
-	cvarManager->registerCvar("fr_color_pauseInactiveB", "175", "", false, true, 0, true, 255, true);
-
-	// extra settings
-	cvarManager->registerCvar("fr_replay_enabled", "1", "", false, true, 0, true, 1, true).bindTo(fr_replay_enabled);
-	cvarManager->registerCvar("fr_switchpov_enabled", "1", "", false, true, 0, true, 1, true).bindTo(fr_switchpov_enabled);
+	/* every setting is described in SETTINGS, its Settings member is refreshed whenever the cvar changes */
+	for (const SettingInfo& info : SETTINGS) {
+		CVarWrapper cvar = cvarManager->registerCvar(info.name, info.defaultValue, "", false, info.hasMin, info.min, info.hasMax, info.max, info.save);
+		readSetting(settings, info, cvar);
+		cvar.addOnValueChanged([this, &info](std::string oldValue, CVarWrapper now) {
+			readSetting(settings, info, now);
+		});
+	}
+
+	/* RGB values of every element */
+	for (int e = 0; e < COLOR_ELEMENT_COUNT; e++) {
+		for (int c = 0; c < 3; c++) {
+			int RGB::* channel = COLOR_CHANNEL_MEMBERS[c];
+			CVarWrapper cvar = cvarManager->registerCvar(COLOR_ELEMENTS[e].cvarPrefix + string(COLOR_CHANNELS[c]),
+				to_string(COLOR_ELEMENTS[e].defaultValue.*channel), "", false, true, 0, true, 255, true);
+			settings.colors[e].*channel = cvar.getIntValue();
+			cvar.addOnValueChanged([this, e, channel](std::string oldValue, CVarWrapper now) {
+				settings.colors[e].*channel = now.getIntValue();
+			});
+		}
+	}
 }
 
 
@@ -391,7 +198,7 @@ void FreeplayRewind::onValuesChanged() {
 	cvarManager->getCvar("fr_enabled").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
 		if (!gameWrapper->IsInFreeplay()) return;
 		clearPlugin();
-		if (*fr_enabled) gameWrapper->RegisterDrawable(bind(&FreeplayRewind::render, this, std::placeholders::_1));
+		if (settings.enabled) gameWrapper->RegisterDrawable(bind(&FreeplayRewind::render, this, std::placeholders::_1));
 	});
 
 	/* Change rewind button Controller and update binding for switch pov */
@@ -412,46 +219,69 @@ void FreeplayRewind::onValuesChanged() {
 
 	cvarManager->getCvar("fr_rewindKeyController").notify();
 
-	/* Change RGB values of active element */
-	cvarManager->getCvar("fr_color_elementR").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
-		if (stoi(oldValue) != now.getIntValue())
-			updateColorValue("R", now.getIntValue());
+	/* Resize the history (only reallocates when the budget or the mode actually changes) */
+	cvarManager->getCvar("fr_rewind_memoryBudget").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		configureHistory();
 	});
 
-	cvarManager->getCvar("fr_color_elementG").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
-		if (stoi(oldValue) != now.getIntValue())
-			updateColorValue("G", now.getIntValue());
+	cvarManager->getCvar("fr_rewind_compressHistory").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		configureHistory();
+	});
+
+	configureHistory();
+
+	cvarManager->getCvar("fr_rewind_adaptive").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		engine.pipeline.drain();
+		engine.recorder.setEnabled(now.getBoolValue());
 	});
 
-	cvarManager->getCvar("fr_color_elementB").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
-		if (stoi(oldValue) != now.getIntValue())
-			updateColorValue("B", now.getIntValue());
+	cvarManager->getCvar("fr_rewind_adaptiveTolerance").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		engine.pipeline.drain();
+		engine.recorder.setTolerance(now.getFloatValue());
 	});
 
+	engine.recorder.setEnabled(settings.rewindAdaptive);
+	engine.recorder.setTolerance(settings.rewindAdaptiveTolerance);
+
+	/* Change RGB values of active element */
+	for (int c = 0; c < 3; c++) {
+		cvarManager->getCvar("fr_color_element" + string(COLOR_CHANNELS[c])).addOnValueChanged([this, c](std::string oldValue, CVarWrapper now) {
+			if (stoi(oldValue) != now.getIntValue())
+				updateColorValue(c, now.getIntValue());
+		});
+	}
+
 	/* Change active element (get RGB values of new element) */
 	cvarManager->getCvar("fr_color_element").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
-		log("dans change element ");
-		string cvarName;
-		if (*fr_color_element == "Filter")					cvarName = "fr_color_filter";
-		else if (*fr_color_element == "Backward active")	cvarName = "fr_color_backwardActive";
-		else if (*fr_color_element == "Backward inactive")	cvarName = "fr_color_backwardInactive";
-		else if (*fr_color_element == "Forward active")		cvarName = "fr_color_forwardActive";
-		else if (*fr_color_element == "Forward inactive")	cvarName = "fr_color_forwardInactive";
-		else if (*fr_color_element == "Pause active")		cvarName = "fr_color_pauseActive";
-		else if (*fr_color_element == "Pause inactive")		cvarName = "fr_color_pauseInactive";
-		else if (*fr_color_element == "Play")				cvarName = "fr_color_play";
-		else cvarName = "fr_color_shadow";
-
-		cvarManager->getCvar("fr_color_elementR").setValue(cvarManager->getCvar(cvarName + "R").getIntValue());
-		cvarManager->getCvar("fr_color_elementG").setValue(cvarManager->getCvar(cvarName + "G").getIntValue());
-		cvarManager->getCvar("fr_color_elementB").setValue(cvarManager->getCvar(cvarName + "B").getIntValue());
+		const RGB& color = settings.colors[colorElementByLabel(settings.colorElement)];
+		for (int c = 0; c < 3; c++)
+			cvarManager->getCvar("fr_color_element" + string(COLOR_CHANNELS[c])).setValue(color.*COLOR_CHANNEL_MEMBERS[c]);
 	});
 
 	cvarManager->getCvar("fr_color_element").notify();
 
+	cvarManager->getCvar("fr_stats_enabled").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		profiler.enabled = settings.statsEnabled;
+	});
+
+	profiler.enabled = settings.statsEnabled;
+
+	cvarManager->getCvar("fr_session_enabled").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		if (settings.sessionEnabled) engine.startSession(SESSION_FILE);
+		else engine.closeSession();
+	});
+
+	if (settings.sessionEnabled) engine.startSession(SESSION_FILE);
+
+	cvarManager->getCvar("fr_rewind_soundQuality").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
+		mixer.setQuality((ResamplerQuality)settings.rewindSoundQuality);
+	});
+
+	mixer.setQuality((ResamplerQuality)settings.rewindSoundQuality);
+
 	cvarManager->getCvar("fr_replay_enabled").addOnValueChanged([this](std::string oldValue, CVarWrapper now) {
 		setReplay();
-		if (gameWrapper->IsInFreeplay() && !*fr_replay_enabled) {
+		if (gameWrapper->IsInFreeplay() && !settings.replayEnabled) {
 			ServerWrapper game = gameWrapper->GetGameEventAsServer();
 			ReplayDirectorWrapper replay = game.GetReplayDirector();
 			game.SetPostGoalTime(3);
@@ -465,20 +295,29 @@ void FreeplayRewind::onValuesChanged() {
 
 
 
-void FreeplayRewind::updateColorValue(string color, int value) {
-	log("dans update color value ", true);
-	if (*fr_color_element == "Filter")					cvarManager->getCvar("fr_color_filter" + color).setValue(value);
-	else if (*fr_color_element == "Backward active")	cvarManager->getCvar("fr_color_backwardActive" + color).setValue(value);
-	else if (*fr_color_element == "Backward inactive")	cvarManager->getCvar("fr_color_backwardInactive" + color).setValue(value);
-	else if (*fr_color_element == "Forward active")		cvarManager->getCvar("fr_color_forwardActive" + color).setValue(value);
-	else if (*fr_color_element == "Forward inactive")	cvarManager->getCvar("fr_color_forwardInactive" + color).setValue(value);
-	else if (*fr_color_element == "Pause active")		cvarManager->getCvar("fr_color_pauseActive" + color).setValue(value);
-	else if (*fr_color_element == "Pause inactive")		cvarManager->getCvar("fr_color_pauseInactive" + color).setValue(value);
-	else if (*fr_color_element == "Play")				cvarManager->getCvar("fr_color_play" + color).setValue(value);
-	else if (*fr_color_element == "Shadow")				cvarManager->getCvar("fr_color_shadow" + color).setValue(value);
+void FreeplayRewind::configureHistory() {
+	engine.pipeline.drain();
+	float budget = settings.rewindMemoryBudget;
+	bool compress = settings.rewindCompressHistory;
+
+	if (compress != engine.history.isCompressed()) {
+		engine.index = -1;
+		engine.recorder.reset();
+	}
+
+	int evicted = (int)engine.history.size();
+	engine.history.configure((size_t)(budget * 1024 * 1024), compress);
+	evicted -= (int)engine.history.size();
+	if (evicted > 0)
+		engine.index = engine.history.empty() ? -1 : max(engine.index - evicted, 0);
+}
+
+
+void FreeplayRewind::updateColorValue(int channel, int value) {
+	ColorElement element = colorElementByLabel(settings.colorElement);
+	cvarManager->getCvar(COLOR_ELEMENTS[element].cvarPrefix + string(COLOR_CHANNELS[channel])).setValue(value);
 }
 
-bool pausedMenuUp = false;
 bool testingKey = false;
 void FreeplayRewind::registerNotifiers() {
 	cvarManager->registerNotifier("fr_bind", [this](std::vector<string> params) {
@@ -493,79 +332,95 @@ void FreeplayRewind::registerNotifiers() {
 	}, "", PERMISSION_ALL);
 
 	// default values
-	cvarManager->registerNotifier("fr_rewind_maxHistory_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_rewind_maxHistory").setValue(375);	 // fr_rewind_maxHistory
+	for (const SettingInfo& info : SETTINGS) {
+		if (!info.defaultNotifier) continue;
+		cvarManager->registerNotifier(info.name + string("_default"), [this, &info](std::vector<string> params) {
+			cvarManager->getCvar(info.name).setValue(string(info.defaultValue));
+		}, "", PERMISSION_ALL);
+	}
+
+	cvarManager->registerNotifier("fr_color_element_default", [this](std::vector<string> params) {
+		const RGB& color = COLOR_ELEMENTS[colorElementByLabel(settings.colorElement)].defaultValue;
+		for (int c = 0; c < 3; c++)
+			cvarManager->getCvar("fr_color_element" + string(COLOR_CHANNELS[c])).setValue(color.*COLOR_CHANNEL_MEMBERS[c]);
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_rewind_backwardSpeed_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_rewind_backwardSpeed").setValue(3.0f);
+
+	cvarManager->registerNotifier("fr_stats", [this](std::vector<string> params) {
+		logStats();
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_rewind_forwardSpeed_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_rewind_forwardSpeed").setValue(2.5f);
+	cvarManager->registerNotifier("fr_stats_reset", [this](std::vector<string> params) {
+		profiler.reset();
+		engine.pipeline.resetPeak();
+		engine.ticks = 0;
+		engine.collapsed = 0;
+		world->calls = WorldCalls();
+		engine.changes.captures = engine.changes.bytes = engine.changes.unchanged = 0;
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_rewind_deadzone_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_rewind_deadzone").setValue(0.05f);
+	cvarManager->registerNotifier("fr_session_list", [this](std::vector<string> params) {
+		listSession();
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_filter_opacity_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_filter_opacity").setValue(60);
+	/* fr_session_load [attempt], the last one by default, negative values count from the end */
+	cvarManager->registerNotifier("fr_session_load", [this](std::vector<string> params) {
+		loadSession(params.size() > 1 ? get_safe_int(params[1]) : -1);
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_filter_fadeSpeed_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_filter_fadeSpeed").setValue(15);
+	cvarManager->registerNotifier("fr_session_clear", [this](std::vector<string> params) {
+		clearSession();
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_filter_shake_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_filter_shake").setValue(25);
+	cvarManager->registerNotifier("fr_branch_next", [this](std::vector<string> params) {
+		cycleBranch(1);
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_icons_positionX_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_icons_positionX").setValue(83);
+	cvarManager->registerNotifier("fr_branch_prev", [this](std::vector<string> params) {
+		cycleBranch(-1);
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_icons_positionY_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_icons_positionY").setValue(13);
+	cvarManager->registerNotifier("fr_branch_list", [this](std::vector<string> params) {
+		listBranches();
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_icons_size_default", [this](std::vector<string> params) {
-		cvarManager->getCvar("fr_icons_size").setValue(1.8f);
+	/* fr_seek <seconds> after the oldest snapshot, negative values count back from the newest one */
+	cvarManager->registerNotifier("fr_seek", [this](std::vector<string> params) {
+		if (params.size() < 2 || !beginSeek()) return;
+		float seconds = get_safe_float(params[1]);
+		seekTo(seconds < 0 ? engine.history.timestamp(engine.history.size() - 1) + seconds : engine.history.timestamp(0) + seconds);
 	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_color_element_default", [this](std::vector<string> params) {
+	/* fr_step <+/-n> snapshots from the current state */
+	cvarManager->registerNotifier("fr_step", [this](std::vector<string> params) {
+		if (params.size() < 2 || !beginSeek()) return;
+		int step = get_safe_int(params[1]);
+		int from = step < 0 && engine.cursor > engine.history.timestamp(engine.index) ? engine.index + 1 : engine.index;	// between two snapshots
+		int to = max(0, min(from + step, (int)engine.history.size() - 1));
+		seekTo(engine.history.timestamp(to));
+	}, "", PERMISSION_ALL);
 
-		if (*fr_color_element == "Backward active" || *fr_color_element == "Forward active" ||
-			*fr_color_element == "Pause active" || *fr_color_element == "Play") {
-			cvarManager->getCvar("fr_color_elementR").setValue(220);
-			cvarManager->getCvar("fr_color_elementG").setValue(210);
-			cvarManager->getCvar("fr_color_elementB").setValue(190);
-		}
-		else if (*fr_color_element == "Backward inactive" || *fr_color_element == "Forward inactive" ||
-			*fr_color_element == "Pause inactive") {
-			cvarManager->getCvar("fr_color_elementR").setValue(185);
-			cvarManager->getCvar("fr_color_elementG").setValue(180);
-			cvarManager->getCvar("fr_color_elementB").setValue(175);
-		}
-		else if (*fr_color_element == "Filter") {
-			cvarManager->getCvar("fr_color_elementR").setValue(130);
-			cvarManager->getCvar("fr_color_elementG").setValue(80);
-			cvarManager->getCvar("fr_color_elementB").setValue(15);
-		}
-		else if (*fr_color_element == "Shadow") {
-			cvarManager->getCvar("fr_color_elementR").setValue(60);
-			cvarManager->getCvar("fr_color_elementG").setValue(60);
-			cvarManager->getCvar("fr_color_elementB").setValue(60);
-		}
+	/* fr_seek_percent <0-100> of the recorded span */
+	cvarManager->registerNotifier("fr_seek_percent", [this](std::vector<string> params) {
+		if (params.size() < 2 || !beginSeek()) return;
+		float first = engine.history.timestamp(0);
+		seekTo(first + (engine.history.timestamp(engine.history.size() - 1) - first) * get_safe_float(params[1]) / 100.0f);
 	}, "", PERMISSION_ALL);
 
+	cvarManager->registerNotifier("fr_shot_save", [this](std::vector<string> params) {
+		if (params.size() > 1) saveShot(params[1]);
+	}, "", PERMISSION_ALL);
 
-	cvarManager->registerNotifier("fr_check_paused", [this](std::vector<string> params) {
-		pausedMenuUp = false;
-	}, "", PERMISSION_PAUSEMENU_CLOSED); // didnt find another way to figure out if game is paused
+	cvarManager->registerNotifier("fr_shot_load", [this](std::vector<string> params) {
+		if (params.size() > 1) loadShot(params[1]);
+	}, "", PERMISSION_ALL);
+
+	cvarManager->registerNotifier("fr_shot_list", [this](std::vector<string> params) {
+		listShots();
+	}, "", PERMISSION_ALL);
 
 	cvarManager->registerNotifier("fr_replaypov_switch", [this](std::vector<string> params) {
-		if (!*fr_switchpov_enabled || (!gameWrapper->IsInGame() && !gameWrapper->IsInOnlineGame() ) )
+		if (!settings.switchPovEnabled || (!gameWrapper->IsInGame() && !gameWrapper->IsInOnlineGame() ) )
 			return;
 		if (gameWrapper->GetLocalCar().IsNull()) 
 			cvarManager->getCvar("cl_goalreplay_pov").setValue(!cvarManager->getCvar("cl_goalreplay_pov").getBoolValue());
@@ -573,6 +428,38 @@ void FreeplayRewind::registerNotifiers() {
 }
 
 
+void FreeplayRewind::logStats() {
+	if (!profiler.enabled)
+		log("fr_stats: timings are off, set fr_stats_enabled to 1");
+
+	for (int i = 0; i < PROFILE_SCOPE_COUNT; i++) {
+		const LatencyHistogram& h = profiler.scopes[i];
+		char line[160];
+		snprintf(line, sizeof(line), "%-16s calls %8llu  p50 %8.1fus  p95 %8.1fus  p99 %8.1fus  max %8.1fus", PROFILE_SCOPE_NAMES[i],
+			(unsigned long long)h.calls(), h.percentile(0.50f) / 1000.0f, h.percentile(0.95f) / 1000.0f,
+			h.percentile(0.99f) / 1000.0f, h.maximum() / 1000.0f);
+		log(line);
+	}
+
+	log("overlay: " + to_string(overlay.drawCalls()) + " draw calls, " + to_string(overlay.size()) + " commands in the last frame");
+	uint64_t calls = engine.ticks + engine.collapsed;
+	log("ticks: " + to_string(engine.ticks) + " run, " + to_string(engine.collapsed) + " redundant PlayerMove calls collapsed ("
+		+ to_string(calls ? (int)(100 * engine.collapsed / calls) : 0) + "%)");
+	const WorldCalls& wrapper = world->calls;
+	double perTick = engine.ticks ? 1.0 / engine.ticks : 0.0;
+	char line[160];
+	snprintf(line, sizeof(line), "world: %.1f reads, %.1f writes per tick, %.1f setters skipped as unchanged", wrapper.reads * perTick,
+		wrapper.writes * perTick, wrapper.skipped * perTick);
+	log(line);
+	log("capture: " + to_string(engine.pipeline.submittedCount()) + " queued, " + to_string(engine.pipeline.droppedCount()) + " dropped, peak queue "
+		+ to_string(engine.pipeline.peakDepth()) + "/" + to_string(CAPTURE_QUEUE_SIZE - 1));
+	snprintf(line, sizeof(line), "changes: %.1f bytes per ball and car delta, %llu captures unchanged",
+		engine.changes.captures ? (double)engine.changes.bytes / engine.changes.captures : 0.0, (unsigned long long)engine.changes.unchanged);
+	log(line);
+	log("session: " + to_string(engine.session.written()) + " snapshots written, " + to_string(engine.session.dropped()) + " dropped");
+}
+
+
 void FreeplayRewind::bindRewindKey(float remaining) {
 	if (remaining < 0) {
 		testingKey = false;
@@ -584,7 +471,7 @@ void FreeplayRewind::bindRewindKey(float remaining) {
 	}
 	else {
 		cvarManager->getCvar("fr_bindKeyStatus").setValue("[" + to_string((int)round(remaining)) + "] Hold down a key");
-		gameWrapper->SetTimeout(std::bind(&FreeplayRewind::bindRewindKey, this, remaining - snapshot_interval), snapshot_interval);
+		gameWrapper->SetTimeout(std::bind(&FreeplayRewind::bindRewindKey, this, remaining - settings.rewindSnapshotInterval), settings.rewindSnapshotInterval);
 	}
 }
 
@@ -607,12 +494,23 @@ bool FreeplayRewind::checkPressedKey() {
 
 
 void FreeplayRewind::hookEvents() {
+	gameWrapper->HookEventWithCaller<VehiclePickupWrapper>("Function TAGame.VehiclePickup_TA.OnPickUp",
+		[this](VehiclePickupWrapper pad, void* params, std::string eventName) {
+		world->padChanged(pad, true);
+	});
+	gameWrapper->HookEventWithCaller<VehiclePickupWrapper>("Function TAGame.VehiclePickup_TA.OnSpawn",
+		[this](VehiclePickupWrapper pad, void* params, std::string eventName) {
+		world->padChanged(pad, false);
+	});
+
 	gameWrapper->HookEvent("Function TAGame.GameEvent_Soccar_TA.OnInit", bind(&FreeplayRewind::startFreeplay, this));
 	gameWrapper->HookEvent("Function PlayerController_TA.Driving.PlayerMove", bind(&FreeplayRewind::onPreAsync, this));
 }
 
 
 void FreeplayRewind::startFreeplay() {
+	engine.restart();
+	world->forgetPads();	// the pads of the previous map
 	clearPlugin();
 	gameWrapper->RegisterDrawable(bind(&FreeplayRewind::render, this, std::placeholders::_1));
 	gameWrapper->SetTimeout(std::bind(&FreeplayRewind::setReplay, this), 1);
@@ -625,7 +523,7 @@ void FreeplayRewind::setReplay() {
 	
 	ServerWrapper game = gameWrapper->GetGameEventAsServer();
 
-	if (*fr_replay_enabled) {
+	if (settings.replayEnabled) {
 		if (game.GetBall().IsNull() || gameWrapper->GetLocalCar().IsNull())
 			return;
 
@@ -654,663 +552,322 @@ void FreeplayRewind::setReplay() {
  Is called when the plugin is *unloaded* by Bakkesmod
 **************************************************************************************************************/
 
-void FreeplayRewind::onUnload() {}
-
-
-
-// rewinding
-bool clearingPlugin = false;
-int index = -2;						// the position of the current state in the history
-vector<GameState> history;			// the recorded game states
-GameState overwrite = GameState();	// the saved state to replay
+void FreeplayRewind::onUnload() {
+	engine.close();	// its history may point into the mapping
+	mixer.close();
+	sessionMapping.close();
+}
 
-float lastRecordTime = .0f;
-float lastTick = 0.0f;
-float snapshotDiff = 0.0f;
-float snapshotElapsed = 0.0f;
 
-bool rewinderEnabled = false;
-bool rewindForward = false;
-bool rewindBackward = false;
-bool startShot = true;
 
-// rendering
-float resX, resY;
+// rewinding, the rest is in engine
+bool worldReady = false;			// in freeplay, enabled, and the ball and the car exist
 
-bool renderPause = false;
-bool renderPlay = false;
-float previousTimePause = 0.0f;
-float previousTimePlay = 0.0f;
-float opacity = 0.0f;
+TripleBuffer<RewindFrame> published;
 
 
 /*************************************************************************************************************
  Rewind, pause, record game
 **************************************************************************************************************/
-float previousTimeUnpaused = 0.0f;
 void FreeplayRewind::onPreAsync() {
+	FR_PROFILE(PROFILE_PRE_ASYNC);
+	updateRewind();
+	publishFrame();
+}
 
-	// check if we can continue
-
-	if (!gameWrapper->IsInFreeplay() || !*fr_enabled || clearingPlugin)
-		return;
 
-	ServerWrapper game = gameWrapper->GetGameEventAsServer();
-	CarWrapper car = game.GetGameCar();
-	BallWrapper ball = game.GetBall();
-
-	if (ball.IsNull() || car.IsNull())
-		return;
+/* the render thread never reads the globals above, only the frames published here */
+void FreeplayRewind::publishFrame() {
+	RewindFrame frame;
+	frame.active = worldReady;
+	frame.rewinderEnabled = engine.rewinderEnabled;
+	frame.rewindForward = engine.rewindForward;
+	frame.rewindBackward = engine.rewindBackward;
+	frame.startShot = engine.startShot;
+	frame.secondsElapsed = worldReady ? world->secondsElapsed() : 0.0f;
+	frame.resets = engine.resets;
+	published.publish(frame);
+}
 
-	rewindForward = false;
-	rewindBackward = false;
-	rewinderEnabled = false;
 
+void FreeplayRewind::updateRewind() {
+	// check if we can continue
 
-	if (*fr_replay_enabled && game.IsInGoal(ball.GetLocation()))
+	worldReady = gameWrapper->IsInFreeplay() && settings.enabled && world->refresh();
+	if (!worldReady)
 		return;
 
-
-	if (!car.GetbIsMoving()) { // when freeplay is reset (pressing reset shot or after goal if enabled)
-		if (history.size() != 0) {
-			clearingPlugin = true;
-
-			history.clear();
-			index = -1;
-			lastTick = .0f;
-			snapshotDiff = .0f;
-			snapshotElapsed = .0f;
-			previousTimeUnpaused = 0.0f;
-			//lastRecordTime = 0.0f;
-
-			clearingPlugin = false;
-		}
-		return;
+	engine.tick(*world, settings, rewindKeyController, rewindKeyKBM);
+	if (engine.rewindBackward || engine.rewindForward) {
+		backwardSound.setSpeed(engine.soundSpeed);
+		forwardSound.setSpeed(engine.soundSpeed);
 	}
+}
 
 
-	pausedMenuUp = true;
-	cvarManager->executeCommand("fr_check_paused", false);	// checks if the paused menu is not up	
-	if (pausedMenuUp) {
-		previousTimeUnpaused = game.GetSecondsElapsed();
-		return;
-	}
+void FreeplayRewind::clearPlugin() {
+	engine.clear();	// counts a reset, the render thread then resets its animations
+	worldReady = false;
+	publishFrame();
+	cvarManager->getCvar("fr_bindKeyStatus").setValue("Click here to quickly bind your rewind button/key");
+	gameWrapper->UnregisterDrawables();
+}
 
 
-	ControllerInput carInput = car.GetInput();
 
-	if (game.GetSecondsElapsed() < previousTimeUnpaused + 0.25) { // after user unpause freeplay, do this for 0.25 s
-		if (!startShot)
-			if (abs(carInput.Throttle) > 0 || abs(carInput.Steer) > 0 || carInput.HoldingBoost == 1 || carInput.Jumped == 1)
-				startShot = true;
 
-		if (!startShot) overwrite.apply(game);
-		else recordGameState();
+/*************************************************************************************************************
+ Session file: every attempt can be loaded back into the history, even after a restart
+**************************************************************************************************************/
 
+void FreeplayRewind::listSession() {
+	SessionMapping mapping;	// the loaded attempt may still be read from sessionMapping
+	if (!mapping.open(SESSION_FILE)) {
+		log("fr_session_list: no session recorded yet");
 		return;
 	}
 
-	// end check
-
-
-	if (!*fr_replay_enabled && cvarManager->getCvar("sv_freeplay_enablegoal").getBoolValue())
-		cvarManager->getCvar("sv_freeplay_enablegoal").setValue(false);
-
-	if (gameWrapper->IsKeyPressed(rewindKeyController) || gameWrapper->IsKeyPressed(rewindKeyKBM)) {
-
-		rewinderEnabled = true;
-		startShot = false;
-
-		float steer = abs(carInput.Steer);
-
-		// replaying shot or pausing rewind
-		if (steer < *fr_rewind_deadzone) {
-			overwrite.apply(game);
-			return;
-		}
-
-		float rewindSpeed = 0.0f;
-		if (steer > 0.75f)		 rewindSpeed = 0.4f * steer;
-		else if (steer > 0.50f)	 rewindSpeed = 0.3f * steer;
-		else rewindSpeed = 0.2f * steer;
+	int count = mapping.attemptCount();
+	log("session: " + to_string(count) + " attempts, " + to_string(mapping.size()) + " snapshots");
+	if (mapping.size() >= SESSION_MAX_RECORDS)
+		log("session: full, nothing more is recorded until fr_session_clear");
+	for (int i = 0; i < count; i++) {
+		SessionAttempt attempt = mapping.attempt(i);
+		if (attempt.recordCount < 2) continue;
+		const SessionRecord& last = mapping.records()[attempt.firstRecord + attempt.recordCount - 1];
+		char line[96];
+		snprintf(line, sizeof(line), "  %4d: %6u snapshots, %7.1fs", i, attempt.recordCount, last.timestamp - attempt.startTime);
+		log(line);
+	}
+}
 
-		if (carInput.Steer < -0.01f) {
-			rewindBackward = true;
-			rewindSpeed *= *fr_rewind_backwardSpeed;
-		}
-		else {
-			rewindForward = true;
-			rewindSpeed *= *fr_rewind_forwardSpeed;
-		}
 
-		float currentTimeInMs = game.GetSecondsElapsed();
-		float tickDiff = currentTimeInMs - lastTick;
-		if (abs(tickDiff) > .1) {
-			lastTick = currentTimeInMs;
-			tickDiff = .01f;
-		}
+/* the history reads the attempt straight from the mapping, and the game is paused at its end */
+void FreeplayRewind::loadSession(int attempt) {
+	if (!gameWrapper->IsInFreeplay() || !settings.enabled || !world->refresh()) {
+		log("fr_session_load: only works in freeplay");
+		return;
+	}
 
-		if (rewindBackward)
-		{
-			if (index > 1 && history.size() > 1) {
-				float deltaElapsed = tickDiff * abs(rewindSpeed);
-				snapshotElapsed += deltaElapsed;
-
-				while (snapshotElapsed > snapshotDiff && index > 1) {
-					index--;
-					snapshotElapsed -= snapshotDiff;
-					snapshotDiff = history.at(index).timestamp - history.at(index - 1).timestamp;
-					if (snapshotDiff > snapshot_interval) { //If user already rewinded once timestamps are wonky at those two points
-						snapshotDiff = snapshot_interval;
-						(history.at(index - 1)).timestamp = history.at(index).timestamp - snapshot_interval;
-					}
-				}
-
-				overwrite.interpolate(history.at(index), history.at(index - 1), snapshotElapsed);
-				overwrite.apply(game);
-			}
-			else {
-				overwrite.apply(game);
-			}
-		}
-		else if (rewindForward) {
-			if (index < history.size() - 2 && history.size() > 1) {
-				float deltaElapsed = tickDiff * abs(rewindSpeed);
-				snapshotElapsed += deltaElapsed;
-
-				while (snapshotElapsed > snapshotDiff && index < history.size() - 2) {
-					index++;
-					snapshotElapsed -= snapshotDiff;
-					snapshotDiff = history.at(index + 1).timestamp - history.at(index).timestamp;
-				}
-
-				overwrite.interpolate(history.at(index), history.at(index + 1), snapshotElapsed);
-				overwrite.apply(game);
-			}
-			else {
-				if (index > 0)
-					overwrite.interpolate(history.at(index), history.at(index), snapshotElapsed);
-
-				overwrite.apply(game);
-			}
-		}
+	engine.pipeline.drain();
+	engine.history.clear();
+	engine.recorder.reset();
+	engine.endAttempt();	// the current attempt ends here either way
+	engine.index = -1;
 
-		lastTick = currentTimeInMs;
+	if (!sessionMapping.open(SESSION_FILE)) {
+		log("fr_session_load: no session recorded yet");
+		return;
 	}
-	else {
-		if (!startShot) {
-			if (abs(carInput.Throttle) > 0 || abs(carInput.Steer) > 0 || carInput.HoldingBoost == 1 || carInput.Jumped == 1)
-				startShot = true;
-		}
-
-		if (*fr_replay_enabled && !cvarManager->getCvar("sv_freeplay_enablegoal").getBoolValue())
-			cvarManager->getCvar("sv_freeplay_enablegoal").setValue(true);
 
-		if (!startShot) overwrite.apply(game);
-		else recordGameState();
+	int count = sessionMapping.attemptCount();
+	if (attempt < 0) attempt += count;
+	if (attempt < 0 || attempt >= count || sessionMapping.attempt(attempt).recordCount < 2) {
+		log("fr_session_load: no attempt " + to_string(attempt) + ", see fr_session_list");
+		sessionMapping.close();
+		return;
 	}
 
+	SessionAttempt loaded = sessionMapping.attempt(attempt);
+	engine.history.attach(sessionMapping.records() + loaded.firstRecord, loaded.recordCount);
+	engine.index = engine.history.size() - 1;
+	engine.lastTick = .0f;
+	engine.cursor = engine.history.timestamp(engine.index);
 
-	//log("index = " + to_string(index));
-	//log("history = " + to_string(history.size()));
-	//log("ts " + str(overwrite.timestamp));
+	engine.overwrite = GameState(engine.history.frame(engine.index), engine.history.timestamp(engine.index));
+	engine.replay(*world);
+	engine.startShot = false;
+	publishFrame();
+	log("fr_session_load: attempt " + to_string(attempt) + ", " + to_string(engine.history.size()) + " snapshots");
 }
 
 
+void FreeplayRewind::clearSession() {
+	engine.pipeline.drain();
+	if (engine.history.isAttached()) {
+		engine.history.clear();
+		engine.recorder.reset();
+		engine.index = -1;
+	}
+	sessionMapping.close();	// the file cannot be truncated while it is mapped
+	engine.clearSession();
+}
 
-void FreeplayRewind::recordGameState() {
 
-	//check if we can continue 
 
-	if (!gameWrapper->IsInFreeplay() || !*fr_enabled || clearingPlugin)
-		return;
 
-	ServerWrapper game = gameWrapper->GetGameEventAsServer();
-	float secondsElapsed = game.GetSecondsElapsed();
+/*************************************************************************************************************
+ Branches: every resume from a rewound state starts a branch, the player can go back to its siblings
+**************************************************************************************************************/
 
-	if (abs(secondsElapsed - lastRecordTime) < snapshot_interval)
+/* the new branch is paused at the same position */
+void FreeplayRewind::cycleBranch(int step) {
+	engine.pipeline.drain();
+	if (!gameWrapper->IsInFreeplay() || !settings.enabled || !world->refresh() || engine.history.empty())
 		return;
 
-	if (game.GetBall().IsNull() || game.GetGameCar().IsNull())
+	vector<int> family = engine.history.branches().family();
+	int at = 0;
+	for (int i = 0; i < (int)family.size(); i++)
+		if (family[i] == engine.history.branches().activeBranch()) at = i;
+
+	for (int n = 1; n < (int)family.size(); n++) {
+		int candidate = family[((at + step * n) % (int)family.size() + (int)family.size()) % (int)family.size()];
+		if (!engine.history.selectBranch(candidate)) continue;
+
+		if (engine.index < 0 || engine.index >= (int)engine.history.size()) engine.index = engine.history.size() - 1;
+		engine.scrubTo(engine.history.timestamp(engine.index), settings);
+		engine.replay(*world);
+		engine.startShot = false;
+		engine.recorder.reset();
+		publishFrame();
+		log("branch " + to_string(candidate) + ", " + to_string(engine.history.size()) + " snapshots");
 		return;
-
-	// end check
-
-	while (history.size() >= *fr_rewind_maxHistory)
-		history.erase(history.begin());
-
-	index = history.size(); //-1;
-	history.push_back(GameState(game, secondsElapsed));
-	lastRecordTime = secondsElapsed;
-
-	if (overwrite.timestamp == 0 && overwrite.ball_location.Z == 0 && history.size() == 1) {
-		overwrite.timestamp = 1;
-		overwrite = history[0];
 	}
+	log("fr_branch: no other branch here");
 }
 
 
-void FreeplayRewind::clearPlugin() {
-	if (history.size() != 0) {
-		clearingPlugin = true;
-
-		overwrite = GameState();
-		history.clear();
-		index = -1;
-		rewinderEnabled = false;
-		rewindForward = false;
-		rewindBackward = false;
-		lastTick = .0f;
-		snapshotDiff = .0f;
-		snapshotElapsed = .0f;
-
-		previousTimeUnpaused = 0.0f;
-		startShot = true;
-		renderPause = false;
-		renderPlay = false;
-		previousTimePause = 0.0f;
-		previousTimePlay = 0.0f;
-		opacity = 0.0f;
-		//lastRecordTime = 0.0f;
-
-		clearingPlugin = false;
+void FreeplayRewind::listBranches() {
+	engine.pipeline.drain();
+	const Timeline& timeline = engine.history.branches();
+	for (int i = 0; i < timeline.branchCount(); i++) {
+		char line[128];
+		snprintf(line, sizeof(line), "%s branch %3d: parent %3d, fork at %6llu, %6llu snapshots", i == timeline.activeBranch() ? ">" : " ",
+			i, timeline.parentOf(i), (unsigned long long)timeline.forkOf(i), (unsigned long long)timeline.lengthOf(i));
+		log(line);
 	}
-	cvarManager->getCvar("fr_bindKeyStatus").setValue("Click here to quickly bind your rewind button/key");
-	gameWrapper->UnregisterDrawables();
 }
 
 
 
 
 /*************************************************************************************************************
- Draw icons, filter, rewind lines, and play sounds
+ Seeking: fr_seek, fr_step and fr_seek_percent jump straight to a state and pause there, as a rewind does
 **************************************************************************************************************/
 
-void FreeplayRewind::render(CanvasWrapper canvas) { // improve this mess sometime
-	resX = canvas.GetSize().X;
-	resY = canvas.GetSize().Y;
-
-	// check if we can render
-	
-	ServerWrapper game = gameWrapper->GetGameEventAsServer();
-
-	if (!gameWrapper->IsInFreeplay() || !*fr_enabled || clearingPlugin
-		|| game.IsNull() || game.GetBall().IsNull() || game.GetGameCar().IsNull()) {
-
-		// sounds could keep playing if it was playing while joining an online game, so:
-		if(backwardSound.isPlaying() || forwardSound.isPlaying())
-			stopSounds();
-
-		return;
+/* false if there is nothing to seek in. Seeking while recording starts from the current state */
+bool FreeplayRewind::beginSeek() {
+	if (!gameWrapper->IsInFreeplay() || !settings.enabled || !world->refresh()) {
+		log("fr_seek: only works in freeplay");
+		return false;
 	}
 
-	// render stuffs
-
-	if (*fr_icons_guidelines) {
-		canvas.SetColor(0, 0, 0, 255);
-		canvas.DrawLine(Vector2F{ resX / 2, 0 }, Vector2F{ resX / 2, resY }, 6);
-		canvas.DrawLine(Vector2F{ 0, resY / 2 }, Vector2F{ resX, resY / 2 }, 6);
+	engine.pipeline.drain();
+	if (engine.startShot) {
+		engine.recorder.flush(engine.history);
+		engine.index = engine.history.size() - 1;
+		if (engine.index >= 0) engine.cursor = engine.history.timestamp(engine.index);
 	}
-
-	float currentTime = gameWrapper->GetGameEventAsServer().GetSecondsElapsed();
-	if (!renderPause && currentTime > previousTimePause + 0.33) {
-		previousTimePause = currentTime;
-		renderPause = true;
+	if (engine.history.size() < 2 || engine.index < 0) {
+		log("fr_seek: nothing recorded yet");
+		return false;
 	}
-
-	// we'll scale based on default resolution: 1920 x 1080 
-	float scaleX = resX / 1920 * (*fr_icons_size);
-	float scaleY = resY / 1080 * (*fr_icons_size);
-
-
-	if (*fr_filter_rewindLines)
-		drawRewindLines(canvas, randomnb(7, 9), resY / 1080, randomnb(1, 3));
-
-
-	if (*fr_filter_show)
-		drawFilter(canvas);
-
-
-	if (*fr_icons_show)
-	{
-		if (rewinderEnabled)
-			previousTimePlay = 0;
-
-		float x = *fr_icons_positionX / 100.0f * resX;
-		float y = *fr_icons_positionY / 100.0f * resY;
+	return true;
+}
 
 
-		if (rewinderEnabled && *fr_icons_autoHide)
-		{
-			if (rewindBackward) {
-				if (*fr_icons_fixedPosition) x -= scaleX * 55.0f;
-				else x -= scaleX * 175.0f;
-				drawBackward(canvas, x, y, scaleX, scaleY, true, true);
-			}
-			else if (rewindForward) {
-				if (*fr_icons_fixedPosition)  x -= scaleX * 45.0f;
-				else x += scaleX * 75.0f;
-				drawForward(canvas, x, y, scaleX, scaleY, true, true);
-			}
-			else if (renderPause)
-				drawPause(canvas, x, y - (scaleY * 10.0f), scaleX, scaleY, true);
+void FreeplayRewind::seekTo(float time) {
+	engine.scrubTo(time, settings);
+	engine.replay(*world);
+	engine.startShot = false;
+	publishFrame();
+}
 
-		}
-		else if (!*fr_icons_autoHide)
-		{
-			drawBackward(canvas, x - (scaleX * 175.0f), y, scaleX, scaleY, rewindBackward, rewindBackward);
-			drawForward(canvas, x + (scaleX * 75.0f), y, scaleX, scaleY, rewindForward, rewindForward);
-
-			if (!rewinderEnabled) {
-				if (!startShot) {
-					renderPlay = false;
-					drawPause(canvas, x, y - (scaleY * 10.0f), scaleX, scaleY, false);
-				}
-				else
-					renderPlay = true;
-			}
-
-			if (!rewindBackward && !rewindForward) {
-				if (rewinderEnabled)
-					drawPause(canvas, x, y - (scaleY * 10.0), scaleX, scaleY, true);
-				else if (renderPlay && startShot) {
-					drawPlay(canvas, x - (scaleX * 25.0), y, scaleX, scaleY);
-					if (!renderPlay)
-						drawPause(canvas, x, y - (scaleY * 10.0), scaleX, scaleY, false);
-				}
-			}
-			else
-				drawPause(canvas, x, y - (scaleY * 10.0), scaleX, scaleY, false);
 
-		}
-		else if (!startShot) {
-			renderPlay = false;
-			drawPause(canvas, x, y - (scaleY * 10.0), scaleX, scaleY, false);
-		}
-		else {
-			renderPlay = true;
-		}
 
-		if (!rewinderEnabled) {
-			renderPause = false;
 
-			float currentTime = gameWrapper->GetGameEventAsServer().GetSecondsElapsed();
-			previousTimePause = currentTime;
+/*************************************************************************************************************
+ Shot library: the current state saved under a name, and loaded back paused
+**************************************************************************************************************/
 
-			if (*fr_icons_autoHide && renderPlay)
-				drawPlay(canvas, x - (scaleX * 25.0), y, scaleX, scaleY);
-		}
+void FreeplayRewind::saveShot(string name) {
+	if (!ShotLibrary::isValidName(name)) {
+		log("fr_shot_save: names are 1 to " + to_string(SHOT_NAME_LENGTH) + " characters long");
+		return;
 	}
-	else if (!rewinderEnabled) { // if we don't render icons, we may still play sounds, so:
-		if (!startShot)	renderPlay = false;
-		else			renderPlay = true;
-
-		renderPause = false;
-		previousTimePause = gameWrapper->GetGameEventAsServer().GetSecondsElapsed();
+	if (!gameWrapper->IsInFreeplay() || !world->refresh()) {
+		log("fr_shot_save: only works in freeplay");
+		return;
 	}
 
-
-	// sounds
-
-	if (rewinderEnabled) {
-		playSound.setPlaying(0);
-		if (*fr_rewind_backwardSound && rewindBackward)		playBackward();
-		else if (*fr_rewind_forwardSound && rewindForward)	playForward();
-		else if (*fr_rewind_pauseSound && renderPause)		playPause();
-		else
-			stopSounds();
-	}
-	else {
-		if (renderPlay && *fr_rewind_playSound)
-			playPlay();
-		else
-			stopSounds();
-	}
+	if (shots.save(name, GameState(*world, world->secondsElapsed()).toFrame()))
+		log("fr_shot_save: saved " + name);
+	else
+		log("fr_shot_save: could not write the shot library");
 }
 
 
-void FreeplayRewind::drawFilter(CanvasWrapper canvas) {
-	if (rewinderEnabled || !startShot) {
-		opacity += (float)* fr_filter_opacity * ((*fr_filter_fadeSpeed / 100.f) / 8.0);
-		if (opacity > * fr_filter_opacity)
-			opacity = *fr_filter_opacity;
-	}
-	else {
-		opacity -= (float)* fr_filter_opacity * ((*fr_filter_fadeSpeed / 100.f) / 8.0);
-		if (opacity < 0.0f)
-			opacity = 0.0f;
+/* the shot replaces the saved state, so it is applied from this tick until the player moves */
+void FreeplayRewind::loadShot(string name) {
+	if (!gameWrapper->IsInFreeplay() || !settings.enabled || !world->refresh()) {
+		log("fr_shot_load: only works in freeplay");
+		return;
 	}
 
-	canvas.SetPosition(Vector2F{ 0, 0 });
-	Vector2F box = { resX, resY };
-	float R = cvarManager->getCvar("fr_color_filterR").getIntValue();
-	float G = cvarManager->getCvar("fr_color_filterG").getIntValue();
-	float B = cvarManager->getCvar("fr_color_filterB").getIntValue();
-	float minOpacity = opacity - (opacity * (float)* fr_filter_shake / 100.f);
-	int o = randomnb(minOpacity, opacity);
-	canvas.SetColor(R, G, B, o);
-	canvas.FillBox(box);
-}
-
-
-void FreeplayRewind::drawPlay(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY) {
-	if (!renderPlay) return;
-
-	float currentTimeP = gameWrapper->GetGameEventAsServer().GetSecondsElapsed();
-	if (previousTimePlay == 0)
-		previousTimePlay = currentTimeP;
-
-	if (currentTimeP < previousTimePlay + 1.25) {
-		Vector2F p1, p2, p3;
-
-		int width = 5;
-		float x2 = x + (width * scaleX);
-		float y2 = y + (width * scaleY);
+	SnapshotFrame frame;
+	if (!shots.load(name, frame)) {
+		log("fr_shot_load: no shot named " + name + ", see fr_shot_list");
+		return;
+	}
 
-		p1 = { x2 + (50 * scaleX), y2 + (25 * scaleY) };
-		p2 = { x2 , y2 };
-		p3 = { x2, y2 + (50 * scaleY) };
-		float R = cvarManager->getCvar("fr_color_shadowB").getIntValue();
-		float G = cvarManager->getCvar("fr_color_shadowG").getIntValue();
-		float B = cvarManager->getCvar("fr_color_shadowR").getIntValue();
-		canvas.FillTriangle(p1, p2, p3, LinearColor{ B, G, R, 1.0f });
+	engine.pipeline.drain();
+	engine.history.clear();
+	engine.recorder.reset();
+	engine.endAttempt();
+	engine.index = -1;
+	engine.lastTick = .0f;
+	engine.cursor = .0f;
 
-		p1 = { x + (50 * scaleX) , y + (25 * scaleY) };
-		p2 = { x, y };
-		p3 = { x, y + (50 * scaleY) };
-		R = cvarManager->getCvar("fr_color_playR").getIntValue();
-		G = cvarManager->getCvar("fr_color_playG").getIntValue();
-		B = cvarManager->getCvar("fr_color_playB").getIntValue();
-		canvas.FillTriangle(p1, p2, p3, LinearColor{ B, G, R, 1.0f });
-	}
-	else
-		renderPlay = false;
+	engine.overwrite = GameState(frame, world->secondsElapsed());
+	engine.replay(*world);
+	engine.startShot = false;
+	publishFrame();
 }
 
 
-void FreeplayRewind::drawRewindLines(CanvasWrapper canvas, int nbLines, float sy, int spacing) {
-	if (rewindBackward) {
-		int heightDiff = randomnb(-3, 0);
-		drawLines(canvas, resY * 0.2, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
-		drawLines(canvas, resY * 0.4, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
-		drawLines(canvas, resY * 0.8, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
-		drawLines(canvas, resY * 0.18, randomnb(-3, 0) * sy, random(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
-		drawLines(canvas, resY * 0.38, randomnb(-3, 0) * sy, random(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
-		drawLines(canvas, resY * 0.84, randomnb(-3, 0) * sy, random(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
-	}
-	else if (rewindForward) {
-		int heightDiff = randomnb(0, 3);
-		drawLines(canvas, resY * 0.1, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
-		drawLines(canvas, resY * 0.3, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
-		drawLines(canvas, resY * 0.7, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
-		drawLines(canvas, resY * 0.07, randomnb(-3, 0) * sy, random(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
-		drawLines(canvas, resY * 0.33, randomnb(-3, 0) * sy, random(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
-		drawLines(canvas, resY * 0.74, randomnb(-3, 0) * sy, random(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
-	}
+void FreeplayRewind::listShots() {
+	vector<string> names = shots.list();
+	log("fr_shot_list: " + to_string(names.size()) + " shots");
+	for (const string& name : names)
+		log("  " + name);
 }
 
 
-void FreeplayRewind::drawLines(CanvasWrapper canvas, float Y, int yd, int nbLines, int minS, int maxS, int minA, int maxA, int spacing) {
-	int j = 0;
-	while (j < nbLines) {
-		int c = randomnb(175, 255);
-		int lineSize = randomnb(minS, maxS);
-		canvas.SetColor(c, c, c, randomnb(minA, maxA));
-		canvas.DrawLine(Vector2F{ 0, Y + yd }, Vector2F{ resX, Y + yd }, lineSize);
-		Y += lineSize + spacing;
-		j++;
-	}
-}
 
 
-void FreeplayRewind::drawBackward(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY, bool active, bool shake) {
-	float n = 0.0f;
-	if (shake && *fr_icons_shake && randomnb(0, 2) == 0)
-		n = scaleX * randomnb(-4, 0);
-
-	int width = 5;
-	float x2 = x - (width * scaleX);
-	float y2 = y + (width * scaleY);
-
-	float R = cvarManager->getCvar("fr_color_shadowR").getIntValue();
-	float G = cvarManager->getCvar("fr_color_shadowG").getIntValue();
-	float B = cvarManager->getCvar("fr_color_shadowB").getIntValue();
-
-	canvas.FillTriangle(
-		Vector2F{ x2 + n , y2 + (25 * scaleY) },
-		Vector2F{ x2 + (50 * scaleX) + n, y2 },
-		Vector2F{ x2 + (50 * scaleX) + n, y2 + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-
-	x2 += (50 * scaleX);
-	canvas.FillTriangle(
-		Vector2F{ x2 + n , y2 + (25 * scaleY) },
-		Vector2F{ x2 + (50 * scaleX) + n, y2 },
-		Vector2F{ x2 + (50 * scaleX) + n, y2 + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-
-	if (active) {
-		R = cvarManager->getCvar("fr_color_backwardActiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_backwardActiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_backwardActiveB").getIntValue();
-	}
-	else {
-		R = cvarManager->getCvar("fr_color_backwardInactiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_backwardInactiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_backwardInactiveB").getIntValue();
-	}
+/*************************************************************************************************************
+ Draw icons, filter, rewind lines, and play sounds
+**************************************************************************************************************/
 
-	canvas.FillTriangle(
-		Vector2F{ x + n , y + (25 * scaleY) },
-		Vector2F{ x + (50 * scaleX) + n, y },
-		Vector2F{ x + (50 * scaleX) + n, y + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-
-	x += (50 * scaleX);
-	canvas.FillTriangle(
-		Vector2F{ x + n , y + (25 * scaleY) },
-		Vector2F{ x + (50 * scaleX) + n, y },
-		Vector2F{ x + (50 * scaleX) + n, y + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
+void FreeplayRewind::render(CanvasWrapper canvas) {
+	FR_PROFILE(PROFILE_RENDER);
+	Vector2 size = canvas.GetSize();
+	OverlaySound sound = overlay.draw(published.read(), (float)size.X, (float)size.Y, settings, gameWrapper->IsInFreeplay());
+	overlay.commands.replay(canvas);
+	playSounds(sound);
 }
 
 
-void FreeplayRewind::drawForward(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY, bool active, bool shake) {
-	float n = 0.0f;
-	if (shake && *fr_icons_shake && randomnb(0, 2) == 0)
-		n = scaleX * randomnb(0, 4);
-
-	int width = 5;
-	float x2 = x + (width * scaleX);
-	float y2 = y + (width * scaleY);
-
-	float R = cvarManager->getCvar("fr_color_shadowR").getIntValue();
-	float G = cvarManager->getCvar("fr_color_shadowG").getIntValue();
-	float B = cvarManager->getCvar("fr_color_shadowB").getIntValue();
-
-	canvas.FillTriangle(
-		Vector2F{ x2 + (50 * scaleX) + n, y2 + (25 * scaleY) },
-		Vector2F{ x2 + n, y2 },
-		Vector2F{ x2 + n, y2 + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-
-	x2 += (50 * scaleX);
-	canvas.FillTriangle(
-		Vector2F{ x2 + (50 * scaleX) + n, y2 + (25 * scaleY) },
-		Vector2F{ x2 + n, y2 },
-		Vector2F{ x2 + n, y2 + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-
-	if (active) {
-		R = cvarManager->getCvar("fr_color_forwardActiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_forwardActiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_forwardActiveB").getIntValue();
-	}
-	else {
-		R = cvarManager->getCvar("fr_color_forwardInactiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_forwardInactiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_forwardInactiveB").getIntValue();
+/* the sounds go with the frame just drawn */
+void FreeplayRewind::playSounds(OverlaySound sound) {
+	if (sound == OverlaySound::Hidden) {
+		// sounds could keep playing if it was playing while joining an online game, so:
+		if (backwardSound.isPlaying() || forwardSound.isPlaying())
+			stopSounds();
+		return;
 	}
 
-	canvas.FillTriangle(
-		Vector2F{ x + (50 * scaleX) + n, y + (25 * scaleY) },
-		Vector2F{ x + n, y },
-		Vector2F{ x + n, y + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-
-	x += (50 * scaleX);
-	canvas.FillTriangle(
-		Vector2F{ x + (50 * scaleX) + n, y + (25 * scaleY) },
-		Vector2F{ x + n, y },
-		Vector2F{ x + n, y + (50 * scaleY) },
-		LinearColor{ B, G, R, 1.0f });
-}
-
+	if (overlay.shown.rewinderEnabled)
+		playSound.setTriggered(false);
 
-void FreeplayRewind::drawPause(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY, bool shake) {
-	float spacing = 15 * scaleX;
-	float n = 0.0f;
-	if (shake && *fr_icons_shake && randomnb(0, 2) == 0)
-		n = randomnb(0, 2);
-
-	int width = 5;
-	float R = cvarManager->getCvar("fr_color_shadowR").getIntValue();
-	float G = cvarManager->getCvar("fr_color_shadowG").getIntValue();
-	float B = cvarManager->getCvar("fr_color_shadowB").getIntValue();
-
-	canvas.SetColor(R, G, B, 255);
-	canvas.DrawLine(
-		Vector2F{ x + (n * scaleX) - spacing + (width * scaleX), y + (n * scaleY) - 1 + (width * scaleY) },
-		Vector2F{ x + (n * scaleX) - spacing + (width * scaleX), y + (50 * scaleY) + (n * scaleY) + 1 + (width * scaleY) }, 20 * scaleX);
-	canvas.DrawLine(
-		Vector2F{ x + (n * scaleX) + spacing + (width * scaleX), y + (n * scaleY) - 1 + (width * scaleY) },
-		Vector2F{ x + (n * scaleX) + spacing + (width * scaleX), y + (50 * scaleY) + (n * scaleY) + 1 + (width * scaleY) }, 20 * scaleX);
-
-	if ((rewinderEnabled && !(rewindBackward || rewindForward)) || (!startShot && *fr_icons_autoHide)) {
-		R = cvarManager->getCvar("fr_color_pauseActiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_pauseActiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_pauseActiveB").getIntValue();
-		canvas.SetColor(R, G, B, 255);
-	}
-	else if (!startShot && !rewinderEnabled && !*fr_icons_autoHide) {
-		R = cvarManager->getCvar("fr_color_pauseActiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_pauseActiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_pauseActiveB").getIntValue();
-		canvas.SetColor(R, G, B, 255);
+	switch (sound) {
+	case OverlaySound::Backward:	playBackward(); break;
+	case OverlaySound::Forward:		playForward(); break;
+	case OverlaySound::Pause:		playPause(); break;
+	case OverlaySound::Play:		playPlay(); break;
+	default:						stopSounds(); break;
 	}
-	else {
-		R = cvarManager->getCvar("fr_color_pauseInactiveR").getIntValue();
-		G = cvarManager->getCvar("fr_color_pauseInactiveG").getIntValue();
-		B = cvarManager->getCvar("fr_color_pauseInactiveB").getIntValue();
-		canvas.SetColor(R, G, B, 255);
-	}
-
-	canvas.DrawLine(
-		Vector2F{ x + (n * scaleX) - spacing, y + (n * scaleY) - 1 },
-		Vector2F{ x + (n * scaleX) - spacing, y + (50 * scaleY) + (n * scaleY) + 1 }, 20 * scaleX);
-	canvas.DrawLine(
-		Vector2F{ x + (n * scaleX) + spacing, y + (n * scaleY) - 1 },
-		Vector2F{ x + (n * scaleX) + spacing, y + (50 * scaleY) + (n * scaleY) + 1 }, 20 * scaleX);
 }
 
 
@@ -1321,47 +878,47 @@ void FreeplayRewind::drawPause(CanvasWrapper canvas, float x, float y, float sca
 *******************************************************/
 
 void FreeplayRewind::playBackward() {
-	if (backwardSound.isPlaying()) return;
+	if (backwardSound.isTriggered()) return;
 	resetSounds(0, 1, 1, 1);
-	backwardSound.play(true, true);
+	backwardSound.play(true);
 }
 
 
 void FreeplayRewind::playForward() {
-	if (forwardSound.isPlaying()) return;
+	if (forwardSound.isTriggered()) return;
 	resetSounds(1, 0, 1, 1);
-	forwardSound.play(true, true);
+	forwardSound.play(true);
 }
 
 
 void FreeplayRewind::playPlay() {
-	if (playSound.isPlaying()) return;
+	if (playSound.isTriggered()) return;
 	resetSounds(1, 1, 1, 0);
-	playSound.play(true, false);
+	playSound.play(false);
 }
 
 
 void FreeplayRewind::playPause() {
-	if (pauseSound.isPlaying()) return;
+	if (pauseSound.isTriggered()) return;
 	resetSounds(1, 1, 0, 1);
-	pauseSound.play(true, false);
+	pauseSound.play(false);
 }
 
 
+/* stops the loops, cues are only re-armed and may finish over the next sound */
 void FreeplayRewind::resetSounds(bool backward, bool forward, bool pause, bool play) {
-	if (backward) backwardSound.setPlaying(0);
-	if (forward) forwardSound.setPlaying(0);
-	if (pause) pauseSound.setPlaying(0);
-	if (play) playSound.setPlaying(0);
+	if (backward) backwardSound.stop();
+	if (forward) forwardSound.stop();
+	if (pause) pauseSound.setTriggered(false);
+	if (play) playSound.setTriggered(false);
 }
 
 
+/* the play cue is left to finish */
 void FreeplayRewind::stopSounds() {
-	if (playSound.isPlaying()) return;
-	pauseSound.setPlaying(0);
-	backwardSound.setPlaying(0);
-	forwardSound.setPlaying(0);
-	PlaySound(NULL, NULL, 0);
+	pauseSound.stop();
+	backwardSound.stop();
+	forwardSound.stop();
 }
 
 
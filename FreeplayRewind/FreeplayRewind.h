@@ -1,15 +1,12 @@
 #pragma once
 #include "bakkesmod/plugin/bakkesmodplugin.h"
+#include "Settings.h"
+#include "BakkesWorld.h"
+#include "Overlay.h"
 #pragma comment( lib, "bakkesmod.lib" )
 #pragma comment( lib, "winmm.lib" )
 
 
-//struct RGB {
-//	unsigned char R;
-//	unsigned char G;
-//	unsigned char B;
-//};
-
 struct KEY {
 	string UnrealName;
 	int Index;
@@ -23,23 +20,8 @@ private:
 	int rewindKeyController;
 	int rewindKeyKBM;
 
-	std::shared_ptr<bool> fr_enabled;
-	/* Rewind settings */
-	std::shared_ptr<bool> fr_rewind_backwardSound, fr_rewind_forwardSound, fr_rewind_pauseSound, fr_rewind_playSound;
-	std::shared_ptr<int> fr_rewind_maxHistory;
-	std::shared_ptr<float> fr_rewind_backwardSpeed, fr_rewind_forwardSpeed, fr_rewind_deadzone;
-	/* Filter settings */
-	std::shared_ptr<bool> fr_filter_show, fr_filter_rewindLines;
-	std::shared_ptr<int> fr_filter_opacity, fr_filter_fadeSpeed, fr_filter_shake;
-	// Icons settings
-	std::shared_ptr<bool> fr_icons_show, fr_icons_autoHide, fr_icons_fixedPosition, fr_icons_shake, fr_icons_guidelines;
-	std::shared_ptr<int> fr_icons_positionX, fr_icons_positionY;
-	std::shared_ptr<float> fr_icons_size;
-	// Color settings
-	std::shared_ptr<string> fr_color_element;
-	std::shared_ptr<int> fr_color_elementR, fr_color_elementG, fr_color_elementB;
-	// Extra settings
-	std::shared_ptr<bool> fr_replay_enabled, fr_switchpov_enabled;
+	Settings settings;	// refreshed by the cvar callbacks, read by the tick and render paths
+	std::shared_ptr<BakkesWorld> world;	// the game as seen by the rewind engine
 
 public:
 	FreeplayRewind() = default;
@@ -48,13 +30,24 @@ public:
 	virtual void onLoad();
 	virtual void onUnload();
 
-	void initVariables();
 	void initKeys();
 	void initSounds();
 	void registerCvars();
 	void onValuesChanged();
-	void updateColorValue(string color, int newValue);
+	void configureHistory();
+	void updateColorValue(int channel, int newValue);
 	void registerNotifiers();
+	void logStats();
+	void listSession();
+	void loadSession(int attempt);
+	void clearSession();
+	void saveShot(string name);
+	void loadShot(string name);
+	void listShots();
+	void cycleBranch(int step);
+	void listBranches();
+	bool beginSeek();
+	void seekTo(float time);
 	void bindRewindKey(float remaining);
 	bool checkPressedKey();
 	void hookEvents();
@@ -62,17 +55,12 @@ public:
 	void setReplay();
 
 	void onPreAsync();
-	void recordGameState();
+	void updateRewind();
+	void publishFrame();
 	void clearPlugin();
 
 	void render(CanvasWrapper canvas);
-	void drawPause(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY, bool shake);
-	void drawBackward(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY, bool active, bool shake);
-	void drawForward(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY, bool active, bool shake);
-	void drawLines(CanvasWrapper canvas, float Y, int yd, int nbLines, int minS, int maxS, int minA, int maxA, int spacing);
-	void drawRewindLines(CanvasWrapper canvas, int nbLines, float scaleY, int spacing);
-	void drawFilter(CanvasWrapper canvas);
-	void drawPlay(CanvasWrapper canvas, float x, float y, float scaleX, float scaleY);
+	void playSounds(OverlaySound sound);
 
 	void playBackward();
 	void playForward();
@@ -0,0 +1,257 @@
+#pragma once
+#include "World.h"
+#include "SnapshotFrame.h"
+#include "CompressedHistory.h"
+#include "Quaternion.h"
+#include <utility>
+
+
+/*************************************************************************************************************
+ Field table of the ball and the car
+
+ Every field a snapshot holds for the ball and the car is described once in GAME_FIELDS: where it lives
+ in GameFields, in WorldState and in a SnapshotFrame, how the kernels interpolate it and how the
+ compressed history quantizes it. Capture, apply, packing into frames (from either of them), equality and
+ the size of a compressed delta are generated from the table. forEachField unrolls it, so each field is
+ a compile-time constant and the generated code is what would be written by hand (Bench/fields.cpp
+ compares the two).
+ Adding a field to the snapshot is a member here and a line in the table.
+**************************************************************************************************************/
+
+/* the ball and the car as every snapshot holds them, GameState adds the rest */
+struct GameFields {
+	Vector ball_location;
+	Vector car_location;
+	Vector ball_velocity;
+	Vector car_velocity;
+	Quaternion ball_rotation;
+	Quaternion car_rotation;
+	Vector ball_ang_velocity;
+	Vector car_ang_velocity;
+	float boost_amount;
+};
+
+
+enum class FieldKind { Vector, Quaternion, Float };
+
+/* the kernel a channel goes through, see SnapshotFrame.h */
+enum class FieldBlend { Linear, Hermite, Nlerp };
+
+struct FieldInfo {
+	FieldKind kind;
+	FieldBlend blend;
+	int body;			// SNAPSHOT_BALL or SNAPSHOT_CAR, in the WorldState arrays
+	int channel;		// in a SnapshotFrame, numbered as in QuantizedLane
+	int lane;			// of the first component in the channel
+	float scale;		// fixed-point steps per unit in the compressed history
+	float limit[4];		// per component
+
+	// where the value goes, only the one matching kind is set
+	Vector GameFields::* vector;
+	Quaternion GameFields::* quaternion;
+	float GameFields::* scalar;
+	Vector (WorldState::* worldVector)[SNAPSHOT_BODIES];
+	Quaternion (WorldState::* worldQuaternion)[SNAPSHOT_BODIES];
+	float WorldState::* worldScalar;
+};
+
+constexpr int fieldComponents(FieldKind kind) {
+	return kind == FieldKind::Vector ? 3 : (kind == FieldKind::Quaternion ? 4 : 1);
+}
+
+constexpr FieldInfo vectorField(Vector GameFields::* member, Vector (WorldState::* world)[SNAPSHOT_BODIES], int body, int channel,
+	FieldBlend blend, float scale, float limitX, float limitY, float limitZ) {
+	return FieldInfo{ FieldKind::Vector, blend, body, channel, 4 * body, scale, { limitX, limitY, limitZ, 0.0f },
+		member, nullptr, nullptr, world, nullptr, nullptr };
+}
+
+constexpr FieldInfo quaternionField(Quaternion GameFields::* member, Quaternion (WorldState::* world)[SNAPSHOT_BODIES], int body) {
+	return FieldInfo{ FieldKind::Quaternion, FieldBlend::Nlerp, body, 3, 4 * body, 16384.0f, { 1.0f, 1.0f, 1.0f, 1.0f },
+		nullptr, member, nullptr, nullptr, world, nullptr };
+}
+
+constexpr FieldInfo floatField(float GameFields::* member, float WorldState::* world, int body, int channel, int lane,
+	FieldBlend blend, float scale, float limit) {
+	return FieldInfo{ FieldKind::Float, blend, body, channel, lane, scale, { limit, 0.0f, 0.0f, 0.0f },
+		nullptr, nullptr, member, nullptr, nullptr, world };
+}
+
+constexpr FieldInfo GAME_FIELDS[] = {
+	vectorField(&GameFields::ball_location, &WorldState::location, SNAPSHOT_BALL, 0, FieldBlend::Hermite, 10.0f, 4200.0f, 6100.0f, 2100.0f),
+	vectorField(&GameFields::car_location, &WorldState::location, SNAPSHOT_CAR, 0, FieldBlend::Hermite, 10.0f, 4200.0f, 6100.0f, 2100.0f),
+	vectorField(&GameFields::ball_velocity, &WorldState::velocity, SNAPSHOT_BALL, 1, FieldBlend::Hermite, 1.0f, 6000.0f, 6000.0f, 6000.0f),
+	vectorField(&GameFields::car_velocity, &WorldState::velocity, SNAPSHOT_CAR, 1, FieldBlend::Hermite, 1.0f, 6000.0f, 6000.0f, 6000.0f),
+	vectorField(&GameFields::ball_ang_velocity, &WorldState::angularVelocity, SNAPSHOT_BALL, 2, FieldBlend::Linear, 1000.0f, 6.0f, 6.0f, 6.0f),
+	vectorField(&GameFields::car_ang_velocity, &WorldState::angularVelocity, SNAPSHOT_CAR, 2, FieldBlend::Linear, 1000.0f, 6.0f, 6.0f, 6.0f),
+	floatField(&GameFields::boost_amount, &WorldState::boost, SNAPSHOT_CAR, 2, 4 * SNAPSHOT_CAR + 3, FieldBlend::Linear, 1000.0f, 100.0f),	// rides in the w lane
+	quaternionField(&GameFields::ball_rotation, &WorldState::rotation, SNAPSHOT_BALL),
+	quaternionField(&GameFields::car_rotation, &WorldState::rotation, SNAPSHOT_CAR),
+};
+
+const size_t GAME_FIELD_COUNT = sizeof(GAME_FIELDS) / sizeof(FieldInfo);
+
+
+/* the table must agree with the kernels and with the lanes the compressed history stores */
+constexpr bool fieldMatchesStorage(const FieldInfo& f) {
+	FieldBlend kernel = f.channel == 3 ? FieldBlend::Nlerp : (f.channel == 2 ? FieldBlend::Linear : FieldBlend::Hermite);
+	if (f.blend != kernel) return false;
+	for (int c = 0; c < fieldComponents(f.kind); c++) {
+		bool found = false;
+		for (const QuantizedLane& q : QUANTIZED_LANES)
+			found = found || (q.channel == f.channel && q.lane == f.lane + c && q.scale == f.scale && q.limit == f.limit[c]);
+		if (!found) return false;
+	}
+	return true;
+}
+
+constexpr bool fieldsMatchStorage() {
+	for (const FieldInfo& f : GAME_FIELDS)
+		if (!fieldMatchesStorage(f)) return false;
+	return true;
+}
+
+static_assert(fieldsMatchStorage(), "GAME_FIELDS disagrees with the interpolation kernels or QUANTIZED_LANES");
+
+
+
+/*************************************************************************************************************
+ Operations generated from the table
+**************************************************************************************************************/
+
+/* calls op(i) for i from 0 to N - 1, i being a std::integral_constant so that decltype(i)::value is a
+   compile-time constant in op */
+template <typename Op, size_t... I>
+inline void unroll(Op&& op, std::index_sequence<I...>) {
+	int expand[] = { 0, (op(std::integral_constant<size_t, I>()), 0)... };
+	(void)expand;
+}
+
+template <size_t N, typename Op>
+inline void unroll(Op&& op) {
+	unroll(op, std::make_index_sequence<N>());
+}
+
+/* an op reads its field as constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value], then every switch on
+   it is decided at compile time, and unroll<fieldComponents(f.kind)> goes through its components */
+template <typename Op>
+inline void forEachField(Op&& op) {
+	unroll<GAME_FIELD_COUNT>(op);
+}
+
+/* component c of a field */
+inline float fieldComponent(const GameFields& state, const FieldInfo& f, int c) {
+	switch (f.kind) {
+	case FieldKind::Vector: {
+		const Vector& v = state.*f.vector;
+		return c == 0 ? v.X : (c == 1 ? v.Y : v.Z);
+	}
+	case FieldKind::Quaternion: {
+		const Quaternion& q = state.*f.quaternion;
+		return c == 0 ? q.x : (c == 1 ? q.y : (c == 2 ? q.z : q.w));
+	}
+	default:
+		return state.*f.scalar;
+	}
+}
+
+/* no motion, no rotation, no boost */
+inline void resetFields(GameFields& state) {
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		switch (f.kind) {
+		case FieldKind::Vector: state.*f.vector = Vector(0, 0, 0); break;
+		case FieldKind::Quaternion: state.*f.quaternion = QUATERNION_IDENTITY; break;
+		case FieldKind::Float: state.*f.scalar = 0.0f; break;
+		}
+	});
+}
+
+inline void captureFields(GameFields& state, const WorldState& world) {
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		switch (f.kind) {
+		case FieldKind::Vector: state.*f.vector = (world.*f.worldVector)[f.body]; break;
+		case FieldKind::Quaternion: state.*f.quaternion = (world.*f.worldQuaternion)[f.body]; break;
+		case FieldKind::Float: state.*f.scalar = world.*f.worldScalar; break;
+		}
+	});
+}
+
+inline void applyFields(const GameFields& state, WorldState& world) {
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		switch (f.kind) {
+		case FieldKind::Vector: (world.*f.worldVector)[f.body] = state.*f.vector; break;
+		case FieldKind::Quaternion: (world.*f.worldQuaternion)[f.body] = state.*f.quaternion; break;
+		case FieldKind::Float: world.*f.worldScalar = state.*f.scalar; break;
+		}
+	});
+}
+
+/* writes the lanes of every field, the others are left as they are */
+inline void packFields(const GameFields& state, SnapshotFrame& frame) {
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		float* lane = channelOf(frame, f.channel) + f.lane;
+		unroll<fieldComponents(f.kind)>([&](auto c) {
+			lane[c] = fieldComponent(state, f, c);
+		});
+	});
+}
+
+/* packFields of a captured world, without going through GameFields */
+inline void packWorldFields(const WorldState& world, SnapshotFrame& frame) {
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		float* lane = channelOf(frame, f.channel) + f.lane;
+		switch (f.kind) {
+		case FieldKind::Vector: {
+			const Vector& v = (world.*f.worldVector)[f.body];
+			lane[0] = v.X; lane[1] = v.Y; lane[2] = v.Z;
+			break;
+		}
+		case FieldKind::Quaternion: {
+			const Quaternion& q = (world.*f.worldQuaternion)[f.body];
+			lane[0] = q.x; lane[1] = q.y; lane[2] = q.z; lane[3] = q.w;
+			break;
+		}
+		case FieldKind::Float: lane[0] = world.*f.worldScalar; break;
+		}
+	});
+}
+
+inline void unpackFields(GameFields& state, const SnapshotFrame& frame) {
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		const float* lane = channelOf(frame, f.channel) + f.lane;
+		switch (f.kind) {
+		case FieldKind::Vector: state.*f.vector = Vector(lane[0], lane[1], lane[2]); break;
+		case FieldKind::Quaternion: state.*f.quaternion = Quaternion{ lane[0], lane[1], lane[2], lane[3] }; break;
+		case FieldKind::Float: state.*f.scalar = lane[0]; break;
+		}
+	});
+}
+
+inline bool sameFields(const GameFields& a, const GameFields& b) {
+	bool same = true;
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		unroll<fieldComponents(f.kind)>([&](auto c) {
+			same = same && fieldComponent(a, f, c) == fieldComponent(b, f, c);
+		});
+	});
+	return same;
+}
+
+/* bytes the compressed history takes to store b after a, outside a keyframe */
+inline int deltaBytes(const GameFields& a, const GameFields& b) {
+	int bytes = 0;
+	forEachField([&](auto i) {
+		constexpr FieldInfo f = GAME_FIELDS[decltype(i)::value];
+		unroll<fieldComponents(f.kind)>([&](auto c) {
+			constexpr QuantizedLane q = QuantizedLane{ f.channel, f.lane + (int)decltype(c)::value, f.scale, f.limit[decltype(c)::value] };
+			bytes += varintBytes(quantizeLane(q, fieldComponent(b, f, c)) - quantizeLane(q, fieldComponent(a, f, c)));
+		});
+	});
+	return bytes;
+}
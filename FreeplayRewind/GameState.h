@@ -0,0 +1,157 @@
+#pragma once
+#include "World.h"
+#include "GameFields.h"
+#include "SnapshotHistory.h"
+#include "Profiler.h"
+#include <vector>
+
+
+/************************************************************************************************************
+ Class for saving game states and rewinding
+**************************************************************************************************************/
+
+class GameState : public GameFields
+{
+public:
+	JumpState jump;
+	PadState pads;
+	float timestamp;
+	std::vector<BodyState> other_balls;	// every other ball and car of the server, see WorldState
+	std::vector<BodyState> other_cars;
+
+	GameState() : jump(), pads(), timestamp(0) {
+		resetFields(*this);
+	}
+
+	GameState(RewindWorld& world, float ts) {
+		WorldState state;
+		world.capture(state);
+		*this = GameState(state, ts);
+	}
+
+	GameState(const WorldState& state, float ts) {
+		captureFields(*this, state);
+		jump = state.jump;
+		pads = state.pads;
+		timestamp = ts;
+		other_balls = state.balls;
+		other_cars = state.cars;
+	}
+
+	/* frames of shots and sessions have no jump state nor pads */
+	GameState(const SnapshotFrame& frame, float ts) {
+		load(frame);
+		jump = JumpState();
+		pads = PadState();
+		timestamp = ts;
+	}
+
+	/* packs the state into the columnar layout of the history */
+	SnapshotFrame toFrame() {
+		SnapshotFrame frame = SnapshotFrame();
+		packFields(*this, frame);
+		return frame;
+	}
+
+	/* packs a captured world into the columnar layout of the history: the ball and the car on the first page,
+	   then the other balls and cars two by two */
+	static void toFrames(const WorldState& world, SnapshotFrame* frames) {
+		frames[0] = SnapshotFrame();
+		packWorldFields(world, frames[0]);
+
+		int others = (int)(world.balls.size() + world.cars.size());
+		int pages = snapshotPages(others);
+		for (int page = 1; page < pages; page++)
+			frames[page] = SnapshotFrame();	// a lone last body leaves a lane empty
+
+		int recorded = (pages - 1) * SNAPSHOT_BODIES;
+		for (int n = 0; n < recorded && n < others; n++) {
+			const BodyState& body = n < (int)world.balls.size() ? world.balls[n] : world.cars[n - world.balls.size()];
+			SnapshotFrame& page = frames[1 + n / SNAPSHOT_BODIES];
+			int lane = n % SNAPSHOT_BODIES;
+			setLane(page.location, lane, body.location, 0);
+			setLane(page.velocity, lane, body.velocity, 0);
+			setLane(page.angularVelocity, lane, body.angularVelocity, body.boost);
+			setLane(page.rotation, lane, body.rotation);
+		}
+	}
+
+	/* unpacks everything but the timestamp, balls and cars are the other bodies the pages were recorded with */
+	void load(const SnapshotFrame* frames, int pages, int balls, int cars) {
+		load(frames[0]);
+
+		int recorded = (pages - 1) * SNAPSHOT_BODIES;
+		if (balls > recorded) balls = recorded;
+		if (cars > recorded - balls) cars = recorded - balls;
+		other_balls.resize(balls);
+		other_cars.resize(cars);
+
+		for (int n = 0; n < balls + cars; n++) {
+			BodyState& body = otherBody(n);
+			const SnapshotFrame& page = frames[1 + n / SNAPSHOT_BODIES];
+			int lane = n % SNAPSHOT_BODIES;
+			body.location = getLane(page.location, lane);
+			body.velocity = getLane(page.velocity, lane);
+			body.angularVelocity = getLane(page.angularVelocity, lane);
+			body.boost = page.angularVelocity.v[4 * lane + 3];
+			body.rotation = getQuaternionLane(page.rotation, lane);
+		}
+	}
+
+	/* unpacks the ball and the car, everything but the timestamp */
+	void load(const SnapshotFrame& frame) {
+		unpackFields(*this, frame);
+	}
+
+	/* for rewinding, interpolate between two recorded instants */
+	void interpolate(const SnapshotHistory& history, size_t from, size_t to, float elapsed, bool cubic) {
+		FR_PROFILE(PROFILE_INTERPOLATE);
+		SnapshotFrame frames[SNAPSHOT_MAX_PAGES];
+		history.interpolate(from, to, elapsed, cubic, frames);
+		load(frames, history.pageCount(), history.otherBalls(), history.otherCars());
+		jump = history.jumpAt(from, elapsed);
+		pads = history.padsAt(from, elapsed);
+	}
+
+	/* state is scratch kept by the caller, its vectors keep their capacity from one tick to the next */
+	void apply(RewindWorld& world, WorldState& state) const {
+		FR_PROFILE(PROFILE_APPLY);
+		applyFields(*this, state);
+		state.jump = jump;
+		state.pads = pads;
+		state.balls = other_balls;
+		state.cars = other_cars;
+		world.apply(state);
+	}
+
+private:
+	BodyState& otherBody(int n) {
+		return n < (int)other_balls.size() ? other_balls[n] : other_cars[n - other_balls.size()];
+	}
+
+	static void setLane(SnapshotChannel& channel, int body, Vector v, float w) {
+		float* lane = channel.v + 4 * body;
+		lane[0] = v.X;
+		lane[1] = v.Y;
+		lane[2] = v.Z;
+		lane[3] = w;
+	}
+
+	static void setLane(SnapshotChannel& channel, int body, Quaternion q) {
+		float* lane = channel.v + 4 * body;
+		lane[0] = q.x;
+		lane[1] = q.y;
+		lane[2] = q.z;
+		lane[3] = q.w;
+	}
+
+	static Vector getLane(const SnapshotChannel& channel, int body) {
+		const float* lane = channel.v + 4 * body;
+		return Vector(lane[0], lane[1], lane[2]);
+	}
+
+	static Quaternion getQuaternionLane(const SnapshotChannel& channel, int body) {
+		const float* lane = channel.v + 4 * body;
+		return Quaternion{ lane[0], lane[1], lane[2], lane[3] };
+	}
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include "Settings.h"
+#include "RenderBuffer.h"
+
+
+/*************************************************************************************************************
+ Cached geometry of the overlay icons
+
+ The vertices of the backward, forward, pause and play icons (shadow and fill) only depend on the
+ resolution, the icon size and the icon position, so they are computed once per layout and render
+ only adds the shake offset and picks the colors.
+**************************************************************************************************************/
+
+/* a triangle, or a line from a to b when lineWidth is set */
+struct IconPrimitive {
+	Vector2F a, b, c;
+	float lineWidth;
+	bool shadow;
+};
+
+struct Icon {
+	IconPrimitive primitives[4];
+	int count;
+
+	void addTriangle(Vector2F a, Vector2F b, Vector2F c, bool shadow) {
+		primitives[count++] = IconPrimitive{ a, b, c, 0.0f, shadow };
+	}
+
+	void addLine(Vector2F a, Vector2F b, float width, bool shadow) {
+		primitives[count++] = IconPrimitive{ a, b, Vector2F{ 0, 0 }, width, shadow };
+	}
+
+	/* shadow primitives come first, so one pass keeps the original draw order */
+	void draw(RenderBuffer& canvas, Vector2F offset, const RGB& shadow, const RGB& fill) const {
+		for (int i = 0; i < count; i++) {
+			const IconPrimitive& p = primitives[i];
+			const RGB& color = p.shadow ? shadow : fill;
+			Vector2F a{ p.a.X + offset.X, p.a.Y + offset.Y };
+			Vector2F b{ p.b.X + offset.X, p.b.Y + offset.Y };
+
+			if (p.lineWidth > 0.0f) {
+				canvas.SetColor(color.R, color.G, color.B, 255);
+				canvas.DrawLine(a, b, p.lineWidth);
+			}
+			else {
+				Vector2F c{ p.c.X + offset.X, p.c.Y + offset.Y };
+				canvas.FillTriangle(a, b, c, LinearColor{ (float)color.B, (float)color.G, (float)color.R, 1.0f });
+			}
+		}
+	}
+};
+
+
+class IconGeometry
+{
+public:
+	IconGeometry() : valid(false) {}
+
+	/* rebuilds the icons if the layout changed since the last frame */
+	void update(float resX, float resY, const Settings& settings) {
+		bool fixed = settings.iconsAutoHide && settings.iconsFixedPosition;
+		if (valid && resX == keyResX && resY == keyResY && settings.iconsSize == keySize
+			&& settings.iconsPositionX == keyPositionX && settings.iconsPositionY == keyPositionY && fixed == keyFixed)
+			return;
+
+		valid = true;
+		keyResX = resX;
+		keyResY = resY;
+		keySize = settings.iconsSize;
+		keyPositionX = settings.iconsPositionX;
+		keyPositionY = settings.iconsPositionY;
+		keyFixed = fixed;
+
+		// we'll scale based on default resolution: 1920 x 1080
+		scaleX = resX / 1920 * settings.iconsSize;
+		scaleY = resY / 1080 * settings.iconsSize;
+
+		float x = settings.iconsPositionX / 100.0f * resX;
+		float y = settings.iconsPositionY / 100.0f * resY;
+
+		// while rewinding with fixed positions the active icon takes the place of the pause icon
+		buildBackward(fixed ? x - scaleX * 55.0f : x - scaleX * 175.0f, y);
+		buildForward(fixed ? x - scaleX * 45.0f : x + scaleX * 75.0f, y);
+		buildPause(x, y - scaleY * 10.0f);
+		buildPlay(x - scaleX * 25.0f, y);
+	}
+
+	float scaleX, scaleY;
+	Icon backward, forward, pause, play;
+
+private:
+	void buildBackward(float x, float y) {
+		backward.count = 0;
+		float width = 5;
+		for (int shadow = 1; shadow >= 0; shadow--) {
+			float x2 = shadow ? x - width * scaleX : x;
+			float y2 = shadow ? y + width * scaleY : y;
+			for (int i = 0; i < 2; i++, x2 += 50 * scaleX)
+				backward.addTriangle(Vector2F{ x2, y2 + 25 * scaleY }, Vector2F{ x2 + 50 * scaleX, y2 },
+					Vector2F{ x2 + 50 * scaleX, y2 + 50 * scaleY }, shadow != 0);
+		}
+	}
+
+	void buildForward(float x, float y) {
+		forward.count = 0;
+		float width = 5;
+		for (int shadow = 1; shadow >= 0; shadow--) {
+			float x2 = shadow ? x + width * scaleX : x;
+			float y2 = shadow ? y + width * scaleY : y;
+			for (int i = 0; i < 2; i++, x2 += 50 * scaleX)
+				forward.addTriangle(Vector2F{ x2 + 50 * scaleX, y2 + 25 * scaleY }, Vector2F{ x2, y2 },
+					Vector2F{ x2, y2 + 50 * scaleY }, shadow != 0);
+		}
+	}
+
+	void buildPause(float x, float y) {
+		pause.count = 0;
+		float width = 5;
+		float spacing = 15 * scaleX;
+		for (int shadow = 1; shadow >= 0; shadow--) {
+			float x2 = shadow ? x + width * scaleX : x;
+			float y2 = shadow ? y + width * scaleY : y;
+			for (float side : { -spacing, spacing })
+				pause.addLine(Vector2F{ x2 + side, y2 - 1 }, Vector2F{ x2 + side, y2 + 50 * scaleY + 1 }, 20 * scaleX, shadow != 0);
+		}
+	}
+
+	void buildPlay(float x, float y) {
+		play.count = 0;
+		float width = 5;
+		for (int shadow = 1; shadow >= 0; shadow--) {
+			float x2 = shadow ? x + width * scaleX : x;
+			float y2 = shadow ? y + width * scaleY : y;
+			play.addTriangle(Vector2F{ x2 + 50 * scaleX, y2 + 25 * scaleY }, Vector2F{ x2, y2 },
+				Vector2F{ x2, y2 + 50 * scaleY }, shadow != 0);
+		}
+	}
+
+	bool valid;
+	float keyResX, keyResY, keySize;
+	int keyPositionX, keyPositionY;
+	bool keyFixed;
+};
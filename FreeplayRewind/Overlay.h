@@ -0,0 +1,319 @@
+#pragma once
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include "Settings.h"
+#include "RenderBuffer.h"
+#include "IconGeometry.h"
+#include "Profiler.h"
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+
+
+/*************************************************************************************************************
+ Overlay: icons, filter, rewind lines and the stats graph
+
+ Draws the last published RewindFrame into a RenderBuffer, which the plugin replays onto the canvas.
+ It owns the animations of the render thread and decides which sound goes with the frame, but plays
+ none: the plugin does. Nothing here needs the game, so the benchmark draws it onto a headless canvas.
+**************************************************************************************************************/
+
+/* the rewind state the render thread draws, published by the game thread after every tick */
+struct RewindFrame {
+	bool active;			// worldReady
+	bool rewinderEnabled;
+	bool rewindForward;
+	bool rewindBackward;
+	bool startShot;
+	float secondsElapsed;
+	uint32_t resets;		// clearPlugin calls, the render thread then restarts its own animations
+};
+
+/* the sound a frame calls for */
+enum class OverlaySound { Hidden, Backward, Forward, Pause, Play, Silence };
+
+/* Returns a random number between min and max */
+inline int randomnb(int min, int max) {
+	return (rand() % (max + 1 - min)) + min;
+}
+
+class Overlay
+{
+public:
+	Overlay() : shown(), shownResets(0), resX(0.0f), resY(0.0f), renderPause(false), renderPlay(false),
+		previousTimePause(0.0f), previousTimePlay(0.0f), opacity(0.0f) {}
+
+	RenderBuffer commands;	// the last frame drawn
+	RewindFrame shown;		// the last published frame
+
+	/* draws frame on a width x height canvas, inFreeplay false hides everything */
+	OverlaySound draw(const RewindFrame& frame, float width, float height, const Settings& settings, bool inFreeplay) {
+		resX = width;
+		resY = height;
+
+		shown = frame;
+		if (shown.resets != shownResets) {	// clearPlugin ran on the game thread
+			shownResets = shown.resets;
+			renderPause = false;
+			renderPlay = false;
+			previousTimePause = 0.0f;
+			previousTimePlay = 0.0f;
+			opacity = 0.0f;
+		}
+
+		commands.clear();
+		return drawOverlay(commands, settings, inFreeplay);
+	}
+
+private:
+	OverlaySound drawOverlay(RenderBuffer& canvas, const Settings& settings, bool inFreeplay) { // improve this mess sometime
+
+		// check if we can render
+
+		if (!inFreeplay || !settings.enabled || !shown.active)
+			return OverlaySound::Hidden;
+
+		// render stuffs
+
+		if (settings.statsGraph)
+			drawStats(canvas);
+
+		if (settings.iconsGuidelines) {
+			canvas.SetColor(0, 0, 0, 255);
+			canvas.DrawLine(Vector2F{ resX / 2, 0 }, Vector2F{ resX / 2, resY }, 6);
+			canvas.DrawLine(Vector2F{ 0, resY / 2 }, Vector2F{ resX, resY / 2 }, 6);
+		}
+
+		float currentTime = shown.secondsElapsed;
+		if (!renderPause && currentTime > previousTimePause + 0.33) {
+			previousTimePause = currentTime;
+			renderPause = true;
+		}
+
+
+		if (settings.filterRewindLines)
+			drawRewindLines(canvas, randomnb(7, 9), resY / 1080, randomnb(1, 3));
+
+
+		if (settings.filterShow)
+			drawFilter(canvas, settings);
+
+
+		if (settings.iconsShow)
+		{
+			if (shown.rewinderEnabled)
+				previousTimePlay = 0;
+
+			icons.update(resX, resY, settings);
+
+			if (shown.rewinderEnabled && settings.iconsAutoHide)
+			{
+				if (shown.rewindBackward)
+					drawBackward(canvas, settings, true, true);
+				else if (shown.rewindForward)
+					drawForward(canvas, settings, true, true);
+				else if (renderPause)
+					drawPause(canvas, settings, true);
+
+			}
+			else if (!settings.iconsAutoHide)
+			{
+				drawBackward(canvas, settings, shown.rewindBackward, shown.rewindBackward);
+				drawForward(canvas, settings, shown.rewindForward, shown.rewindForward);
+
+				if (!shown.rewinderEnabled) {
+					if (!shown.startShot) {
+						renderPlay = false;
+						drawPause(canvas, settings, false);
+					}
+					else
+						renderPlay = true;
+				}
+
+				if (!shown.rewindBackward && !shown.rewindForward) {
+					if (shown.rewinderEnabled)
+						drawPause(canvas, settings, true);
+					else if (renderPlay && shown.startShot) {
+						drawPlay(canvas, settings);
+						if (!renderPlay)
+							drawPause(canvas, settings, false);
+					}
+				}
+				else
+					drawPause(canvas, settings, false);
+
+			}
+			else if (!shown.startShot) {
+				renderPlay = false;
+				drawPause(canvas, settings, false);
+			}
+			else {
+				renderPlay = true;
+			}
+
+			if (!shown.rewinderEnabled) {
+				renderPause = false;
+
+				previousTimePause = currentTime;
+
+				if (settings.iconsAutoHide && renderPlay)
+					drawPlay(canvas, settings);
+			}
+		}
+		else if (!shown.rewinderEnabled) { // if we don't render icons, we may still play sounds, so:
+			if (!shown.startShot)	renderPlay = false;
+			else			renderPlay = true;
+
+			renderPause = false;
+			previousTimePause = currentTime;
+		}
+
+
+		// sounds
+
+		if (shown.rewinderEnabled) {
+			if (settings.rewindBackwardSound && shown.rewindBackward)		return OverlaySound::Backward;
+			else if (settings.rewindForwardSound && shown.rewindForward)	return OverlaySound::Forward;
+			else if (settings.rewindPauseSound && renderPause)		return OverlaySound::Pause;
+			return OverlaySound::Silence;
+		}
+		return renderPlay && settings.rewindPlaySound ? OverlaySound::Play : OverlaySound::Silence;
+	}
+
+	void drawFilter(RenderBuffer& canvas, const Settings& settings) {
+		if (shown.rewinderEnabled || !shown.startShot) {
+			opacity += (float)settings.filterOpacity * ((settings.filterFadeSpeed / 100.f) / 8.0);
+			if (opacity > settings.filterOpacity)
+				opacity = settings.filterOpacity;
+		}
+		else {
+			opacity -= (float)settings.filterOpacity * ((settings.filterFadeSpeed / 100.f) / 8.0);
+			if (opacity < 0.0f)
+				opacity = 0.0f;
+		}
+
+		canvas.SetPosition(Vector2F{ 0, 0 });
+		Vector2F box = { resX, resY };
+		float R = settings.colors[COLOR_FILTER].R;
+		float G = settings.colors[COLOR_FILTER].G;
+		float B = settings.colors[COLOR_FILTER].B;
+		float minOpacity = opacity - (opacity * (float)settings.filterShake / 100.f);
+		int o = randomnb(minOpacity, opacity);
+		canvas.SetColor(R, G, B, o);
+		canvas.FillBox(box);
+	}
+
+	void drawPlay(RenderBuffer& canvas, const Settings& settings) {
+		if (!renderPlay) return;
+
+		float currentTimeP = shown.secondsElapsed;
+		if (previousTimePlay == 0)
+			previousTimePlay = currentTimeP;
+
+		if (currentTimeP < previousTimePlay + 1.25) {
+			// the play shadow has always been drawn with its red and blue swapped compared to the other icons
+			const RGB& shadow = settings.colors[COLOR_SHADOW];
+			icons.play.draw(canvas, Vector2F{ 0, 0 }, RGB{ shadow.B, shadow.G, shadow.R }, settings.colors[COLOR_PLAY]);
+		}
+		else
+			renderPlay = false;
+	}
+
+	void drawRewindLines(RenderBuffer& canvas, int nbLines, float sy, int spacing) {
+		if (shown.rewindBackward) {
+			int heightDiff = randomnb(-3, 0);
+			drawLines(canvas, resY * 0.2, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
+			drawLines(canvas, resY * 0.4, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
+			drawLines(canvas, resY * 0.8, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
+			drawLines(canvas, resY * 0.18, randomnb(-3, 0) * sy, randomnb(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
+			drawLines(canvas, resY * 0.38, randomnb(-3, 0) * sy, randomnb(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
+			drawLines(canvas, resY * 0.84, randomnb(-3, 0) * sy, randomnb(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
+		}
+		else if (shown.rewindForward) {
+			int heightDiff = randomnb(0, 3);
+			drawLines(canvas, resY * 0.1, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
+			drawLines(canvas, resY * 0.3, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
+			drawLines(canvas, resY * 0.7, heightDiff * sy, nbLines, 1 * sy, 3 * sy, 40, 165, spacing * sy);
+			drawLines(canvas, resY * 0.07, randomnb(-3, 0) * sy, randomnb(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
+			drawLines(canvas, resY * 0.33, randomnb(-3, 0) * sy, randomnb(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
+			drawLines(canvas, resY * 0.74, randomnb(-3, 0) * sy, randomnb(-3, 3), 1 * sy, 1 * sy, 20, 100, spacing * sy);
+		}
+	}
+
+	void drawLines(RenderBuffer& canvas, float Y, int yd, int nbLines, int minS, int maxS, int minA, int maxA, int spacing) {
+		int j = 0;
+		while (j < nbLines) {
+			int c = randomnb(175, 255);
+			int lineSize = randomnb(minS, maxS);
+			canvas.SetColor(c, c, c, randomnb(minA, maxA));
+			canvas.DrawLine(Vector2F{ 0, Y + yd }, Vector2F{ resX, Y + yd }, lineSize);
+			Y += lineSize + spacing;
+			j++;
+		}
+	}
+
+	void drawBackward(RenderBuffer& canvas, const Settings& settings, bool active, bool shake) {
+		float n = 0.0f;
+		if (shake && settings.iconsShake && randomnb(0, 2) == 0)
+			n = icons.scaleX * randomnb(-4, 0);
+
+		const RGB& fill = settings.colors[active ? COLOR_BACKWARD_ACTIVE : COLOR_BACKWARD_INACTIVE];
+		icons.backward.draw(canvas, Vector2F{ n, 0 }, settings.colors[COLOR_SHADOW], fill);
+	}
+
+	void drawForward(RenderBuffer& canvas, const Settings& settings, bool active, bool shake) {
+		float n = 0.0f;
+		if (shake && settings.iconsShake && randomnb(0, 2) == 0)
+			n = icons.scaleX * randomnb(0, 4);
+
+		const RGB& fill = settings.colors[active ? COLOR_FORWARD_ACTIVE : COLOR_FORWARD_INACTIVE];
+		icons.forward.draw(canvas, Vector2F{ n, 0 }, settings.colors[COLOR_SHADOW], fill);
+	}
+
+	void drawPause(RenderBuffer& canvas, const Settings& settings, bool shake) {
+		float n = 0.0f;
+		if (shake && settings.iconsShake && randomnb(0, 2) == 0)
+			n = randomnb(0, 2);
+
+		bool active = (shown.rewinderEnabled && !(shown.rewindBackward || shown.rewindForward)) || (!shown.startShot && settings.iconsAutoHide)
+			|| (!shown.startShot && !shown.rewinderEnabled && !settings.iconsAutoHide);
+		const RGB& fill = settings.colors[active ? COLOR_PAUSE_ACTIVE : COLOR_PAUSE_INACTIVE];
+		icons.pause.draw(canvas, Vector2F{ n * icons.scaleX, n * icons.scaleY }, settings.colors[COLOR_SHADOW], fill);
+	}
+
+	/* recent onPreAsync (bottom) and render (above it) timings, one bar per call, 1 px per 10us */
+	void drawStats(RenderBuffer& canvas) {
+		const ProfileScope graphed[] = { PROFILE_PRE_ASYNC, PROFILE_RENDER };
+		float left = 20.0f;
+		float bottom = resY - 20.0f;
+
+		for (ProfileScope scope : graphed) {
+			const LatencyHistogram& h = profiler.scopes[scope];
+			canvas.SetColor(0, 0, 0, 120);
+			canvas.SetPosition(Vector2F{ left, bottom - 100.0f });
+			canvas.FillBox(Vector2F{ PROFILE_RECENT * 2.0f, 100.0f });
+
+			canvas.SetColor(255, 255, 255, 255);
+			canvas.SetPosition(Vector2F{ left, bottom - 115.0f });
+			canvas.DrawString(std::string(PROFILE_SCOPE_NAMES[scope]) + " p99 " + std::to_string(h.percentile(0.99f) / 1000) + "us");
+
+			canvas.SetColor(120, 220, 120, 255);
+			for (int i = 0; i < PROFILE_RECENT; i++) {
+				float height = h.recentSample(i) / 10000.0f;
+				if (height > 100.0f) height = 100.0f;
+				float x = left + (PROFILE_RECENT - 1 - i) * 2.0f;
+				canvas.DrawLine(Vector2F{ x, bottom }, Vector2F{ x, bottom - height }, 2.0f);
+			}
+			bottom -= 140.0f;
+		}
+	}
+
+	uint32_t shownResets;
+	float resX, resY;
+	IconGeometry icons;
+
+	bool renderPause;
+	bool renderPlay;
+	float previousTimePause;
+	float previousTimePlay;
+	float opacity;
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ Per-hook timing
+
+ FR_PROFILE(scope) times the rest of the enclosing block into that scope's histogram. Histograms are
+ log-linear (4 buckets per power of two of nanoseconds) made of relaxed atomic counters, so recording
+ never locks and fr_stats can read them from any thread. When profiling is turned off at runtime a
+ scope costs one branch, building with FR_PROFILING 0 removes the timers entirely.
+**************************************************************************************************************/
+
+#ifndef FR_PROFILING
+#define FR_PROFILING 1
+#endif
+
+enum ProfileScope {
+	PROFILE_PRE_ASYNC,
+	PROFILE_RECORD,
+	PROFILE_APPLY,
+	PROFILE_INTERPOLATE,
+	PROFILE_RENDER,
+	PROFILE_PROCESS,
+	PROFILE_SCOPE_COUNT
+};
+
+const char* const PROFILE_SCOPE_NAMES[PROFILE_SCOPE_COUNT] = { "onPreAsync", "recordGameState", "apply", "interpolate", "render", "processCapture" };
+
+const int PROFILE_BUCKETS = 4 * 40;		// up to ~18 minutes, far beyond anything a hook takes
+const int PROFILE_RECENT = 128;			// samples kept for the on-canvas graph
+
+class LatencyHistogram
+{
+public:
+	LatencyHistogram() { reset(); }
+
+	void reset() {
+		for (int i = 0; i < PROFILE_BUCKETS; i++)
+			buckets[i].store(0, std::memory_order_relaxed);
+		for (int i = 0; i < PROFILE_RECENT; i++)
+			recent[i].store(0, std::memory_order_relaxed);
+		count.store(0, std::memory_order_relaxed);
+		max.store(0, std::memory_order_relaxed);
+	}
+
+	void record(uint64_t ns) {
+		buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+		uint64_t n = count.fetch_add(1, std::memory_order_relaxed);
+		recent[n % PROFILE_RECENT].store((uint32_t)(ns > UINT32_MAX ? UINT32_MAX : ns), std::memory_order_relaxed);
+
+		uint64_t previous = max.load(std::memory_order_relaxed);
+		while (ns > previous && !max.compare_exchange_weak(previous, ns, std::memory_order_relaxed)) {}
+	}
+
+	uint64_t calls() const { return count.load(std::memory_order_relaxed); }
+	uint64_t maximum() const { return max.load(std::memory_order_relaxed); }
+
+	/* upper bound of the bucket holding the given quantile (0-1), in ns */
+	uint64_t percentile(float quantile) const {
+		uint64_t total = 0;
+		uint64_t counts[PROFILE_BUCKETS];
+		for (int i = 0; i < PROFILE_BUCKETS; i++)
+			total += counts[i] = buckets[i].load(std::memory_order_relaxed);
+		if (total == 0) return 0;
+
+		uint64_t rank = (uint64_t)(quantile * (total - 1)) + 1;
+		uint64_t seen = 0;
+		for (int i = 0; i < PROFILE_BUCKETS; i++) {
+			seen += counts[i];
+			if (seen >= rank) {
+				uint64_t bound = upperBound(i);
+				uint64_t largest = maximum();
+				return bound < largest ? bound : largest;
+			}
+		}
+		return maximum();
+	}
+
+	/* the i-th most recent sample, in ns */
+	uint32_t recentSample(int i) const {
+		uint64_t n = count.load(std::memory_order_relaxed);
+		if ((uint64_t)i >= n || i >= PROFILE_RECENT) return 0;
+		return recent[(n - 1 - i) % PROFILE_RECENT].load(std::memory_order_relaxed);
+	}
+
+private:
+	/* 0-7 are exact, then 4 buckets per power of two */
+	static int bucketOf(uint64_t ns) {
+		if (ns < 8) return (int)ns;
+		int exponent = 0;
+		for (uint64_t v = ns; v > 1; v >>= 1) exponent++;
+		int bucket = exponent * 4 + (int)((ns >> (exponent - 2)) & 3);
+		return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+	}
+
+	static uint64_t upperBound(int bucket) {
+		if (bucket < 8) return bucket;
+		int exponent = bucket / 4;
+		return ((uint64_t)(5 + bucket % 4) << (exponent - 2)) - 1;
+	}
+
+	std::atomic<uint64_t> buckets[PROFILE_BUCKETS];
+	std::atomic<uint32_t> recent[PROFILE_RECENT];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> max;
+};
+
+
+class Profiler
+{
+public:
+	Profiler() : enabled(false) {}
+
+	bool enabled;	// fr_stats_enabled
+	LatencyHistogram scopes[PROFILE_SCOPE_COUNT];
+
+	void reset() {
+		for (int i = 0; i < PROFILE_SCOPE_COUNT; i++)
+			scopes[i].reset();
+	}
+};
+
+
+class ScopedTimer
+{
+public:
+	ScopedTimer(Profiler& profiler, ProfileScope scope) : histogram(profiler.enabled ? &profiler.scopes[scope] : nullptr) {
+		if (histogram) start = std::chrono::steady_clock::now();
+	}
+
+	~ScopedTimer() {
+		if (histogram)
+			histogram->record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+private:
+	LatencyHistogram* histogram;
+	std::chrono::steady_clock::time_point start;
+};
+
+extern Profiler profiler;	// the one FR_PROFILE records into, fr_stats
+
+#if FR_PROFILING
+#define FR_PROFILE(scope) ScopedTimer profileTimer_(profiler, scope)
+#else
+#define FR_PROFILE(scope)
+#endif
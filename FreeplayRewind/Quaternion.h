@@ -0,0 +1,62 @@
+#pragma once
+#include <cmath>
+
+
+/*************************************************************************************************************
+ Rotations as unit quaternions (x, y, z, w)
+
+ The history stores and blends quaternions, which have no wrap-around and no gimbal lock. They are only
+ turned back into pitch, yaw and roll in unreal units when set on an actor. The conversions are the
+ ones of FRotator::Quaternion and FQuat::Rotator, so a rotator survives the round trip.
+**************************************************************************************************************/
+
+const float ROTATION_UNITS_PER_RADIAN = 32768.0f / 3.14159265f;
+
+struct Quaternion {
+	float x, y, z, w;
+};
+
+const Quaternion QUATERNION_IDENTITY = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+/* pitch, yaw and roll in unreal units. w is made positive, q and -q being the same rotation, so that
+   successive captures of a slow body stay close */
+inline Quaternion quaternionFromRotation(int pitch, int yaw, int roll) {
+	float half = 0.5f / ROTATION_UNITS_PER_RADIAN;
+	float sp = sinf(pitch * half), cp = cosf(pitch * half);
+	float sy = sinf(yaw * half), cy = cosf(yaw * half);
+	float sr = sinf(roll * half), cr = cosf(roll * half);
+
+	Quaternion q = {
+		cr * sp * sy - sr * cp * cy,
+		-cr * sp * cy - sr * cp * sy,
+		cr * cp * sy - sr * sp * cy,
+		cr * cp * cy + sr * sp * sy
+	};
+	if (q.w < 0.0f) q = Quaternion{ -q.x, -q.y, -q.z, -q.w };
+	return q;
+}
+
+/* pitch within +/- 16384, yaw and roll within +/- 32768 unreal units. A zero quaternion gives no rotation */
+inline void quaternionToRotation(const Quaternion& q, int& pitch, int& yaw, int& roll) {
+	const float pi = 3.14159265f;
+	float singularity = q.z * q.x - q.w * q.y;
+	float y = atan2f(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z));
+	float p, r;
+
+	if (singularity < -0.4999995f) {		// straight down, roll and yaw turn around the same axis
+		p = -0.5f * pi;
+		r = remainderf(-y - 2.0f * atan2f(q.x, q.w), 2.0f * pi);
+	}
+	else if (singularity > 0.4999995f) {	// straight up
+		p = 0.5f * pi;
+		r = remainderf(y - 2.0f * atan2f(q.x, q.w), 2.0f * pi);
+	}
+	else {
+		p = asinf(2.0f * singularity);
+		r = atan2f(-2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+	}
+
+	pitch = (int)lroundf(p * ROTATION_UNITS_PER_RADIAN);
+	yaw = (int)lroundf(y * ROTATION_UNITS_PER_RADIAN);
+	roll = (int)lroundf(r * ROTATION_UNITS_PER_RADIAN);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+
+/*************************************************************************************************************
+ Overlay render commands
+
+ The overlay is drawn into a RenderBuffer, which has the same drawing calls as CanvasWrapper, and the
+ buffer is then replayed onto the canvas. Replay works with anything that has those calls, so the
+ same frame can be counted or compared without the game. Colors that are set again without a
+ change are dropped while recording.
+**************************************************************************************************************/
+
+enum class RenderOp : uint8_t { Color, Position, Line, Triangle, Box, String };
+
+struct RenderCommand {
+	RenderOp op;
+	unsigned char rgba[4];	// Color
+	float width;			// Line
+	Vector2F p[3];			// Position and Box use p[0], Line p[0..1], Triangle p[0..2]
+	LinearColor color;		// Triangle
+	size_t text;			// String, index in the text table
+};
+
+class RenderBuffer
+{
+public:
+	RenderBuffer() : hasColor(false), calls(0) {}
+
+	void clear() {
+		commands.clear();	// keeps the capacity, no allocation once the overlay has been drawn once
+		texts.clear();
+		hasColor = false;
+		calls = 0;
+	}
+
+	void SetColor(char r, char g, char b, char a) {
+		unsigned char rgba[4] = { (unsigned char)r, (unsigned char)g, (unsigned char)b, (unsigned char)a };
+		if (hasColor && std::equal(rgba, rgba + 4, color))
+			return;
+
+		std::copy(rgba, rgba + 4, color);
+		hasColor = true;
+		RenderCommand& c = push(RenderOp::Color);
+		std::copy(rgba, rgba + 4, c.rgba);
+	}
+
+	void SetPosition(Vector2F position) {
+		push(RenderOp::Position).p[0] = position;
+	}
+
+	void DrawLine(Vector2F start, Vector2F end, float width) {
+		RenderCommand& c = push(RenderOp::Line);
+		c.p[0] = start;
+		c.p[1] = end;
+		c.width = width;
+		calls++;
+	}
+
+	void FillTriangle(Vector2F p1, Vector2F p2, Vector2F p3, LinearColor color) {
+		RenderCommand& c = push(RenderOp::Triangle);
+		c.p[0] = p1;
+		c.p[1] = p2;
+		c.p[2] = p3;
+		c.color = color;
+		calls++;
+	}
+
+	void FillBox(Vector2F size) {
+		push(RenderOp::Box).p[0] = size;
+		calls++;
+	}
+
+	void DrawString(const std::string& text) {
+		push(RenderOp::String).text = texts.size();
+		texts.push_back(text);
+		calls++;
+	}
+
+	size_t size() const { return commands.size(); }
+	size_t drawCalls() const { return calls; }
+
+	/* replays the frame onto a CanvasWrapper, or anything with the same drawing calls */
+	template <typename Canvas>
+	void replay(Canvas& canvas) const {
+		for (const RenderCommand& c : commands) {
+			switch (c.op) {
+			case RenderOp::Color:		canvas.SetColor(c.rgba[0], c.rgba[1], c.rgba[2], c.rgba[3]); break;
+			case RenderOp::Position:	canvas.SetPosition(c.p[0]); break;
+			case RenderOp::Line:		canvas.DrawLine(c.p[0], c.p[1], c.width); break;
+			case RenderOp::Triangle:	canvas.FillTriangle(c.p[0], c.p[1], c.p[2], c.color); break;
+			case RenderOp::Box:			canvas.FillBox(c.p[0]); break;
+			case RenderOp::String:		canvas.DrawString(texts[c.text]); break;
+			}
+		}
+	}
+
+private:
+	RenderCommand& push(RenderOp op) {
+		commands.emplace_back();
+		RenderCommand& c = commands.back();
+		c.op = op;
+		return c;
+	}
+
+	std::vector<RenderCommand> commands;
+	std::vector<std::string> texts;
+	unsigned char color[4];		// last color recorded
+	bool hasColor;
+	size_t calls;
+};
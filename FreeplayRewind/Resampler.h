@@ -0,0 +1,92 @@
+#pragma once
+#include <immintrin.h>
+#include <vector>
+#include <cmath>
+
+
+/*************************************************************************************************************
+ Windowed-sinc polyphase resampler
+
+ Each quality level has a Blackman-windowed sinc filter sampled at RESAMPLER_PHASES fractional
+ positions. Each filter is built for a few maximum ratios: when a voice plays faster, a table with
+ a lower cutoff is picked so the sound does not alias. Because of that the ratio can change on every
+ block at no cost. One output sample is one SSE dot product per channel.
+**************************************************************************************************************/
+
+enum ResamplerQuality {
+	RESAMPLER_FAST,		// 8 taps
+	RESAMPLER_MEDIUM,	// 16 taps
+	RESAMPLER_HIGH,		// 32 taps
+	RESAMPLER_QUALITY_COUNT
+};
+
+const int RESAMPLER_TAPS[RESAMPLER_QUALITY_COUNT] = { 8, 16, 32 };
+const int RESAMPLER_MAX_TAPS = 32;
+const int RESAMPLER_PHASES = 256;
+const int RESAMPLER_CUTOFFS = 4;
+const float RESAMPLER_RATIOS[RESAMPLER_CUTOFFS] = { 1.0f, 1.5f, 2.25f, 4.0f };	// highest ratio of each table
+const float RESAMPLER_MAX_RATIO = 4.0f;
+
+/* n must be a multiple of 4 */
+inline float dotProduct(const float* a, const float* b, int n) {
+	__m128 sum = _mm_setzero_ps();
+	for (int i = 0; i < n; i += 4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+class Resampler
+{
+public:
+	explicit Resampler(ResamplerQuality quality) : taps(RESAMPLER_TAPS[quality]) {
+		const double pi = 3.14159265358979323846;
+		int half = taps / 2;
+		coefficients.resize((size_t)RESAMPLER_CUTOFFS * RESAMPLER_PHASES * taps);
+
+		for (int c = 0; c < RESAMPLER_CUTOFFS; c++) {
+			double cutoff = 0.95 / RESAMPLER_RATIOS[c];
+			for (int phase = 0; phase < RESAMPLER_PHASES; phase++) {
+				float* h = &coefficients[((size_t)c * RESAMPLER_PHASES + phase) * taps];
+				double fraction = (double)phase / RESAMPLER_PHASES;
+				double sum = 0;
+				for (int k = 0; k < taps; k++) {
+					double x = (k - half + 1) - fraction;
+					double sinc = x == 0 ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x);
+					double w = (x + half) / taps;	// 0 to 1 across the window
+					double window = w <= 0 || w >= 1 ? 0.0 : 0.42 - 0.5 * cos(2 * pi * w) + 0.08 * cos(4 * pi * w);
+					h[k] = (float)(sinc * window);
+					sum += h[k];
+				}
+				for (int k = 0; k < taps; k++)	// unity gain at DC
+					h[k] = (float)(h[k] / sum);
+			}
+		}
+	}
+
+	/* the first input sample a position reads is floor(position) + firstTap() */
+	int firstTap() const { return 1 - taps / 2; }
+	int tapCount() const { return taps; }
+
+	/* the filter for a playback ratio (input frames per output frame) */
+	const float* filter(double ratio) const {
+		int c = 0;
+		while (c < RESAMPLER_CUTOFFS - 1 && ratio > RESAMPLER_RATIOS[c]) c++;
+		return &coefficients[(size_t)c * RESAMPLER_PHASES * taps];
+	}
+
+	/* one stereo frame at a fractional position, left and right are padded by firstTap on both sides */
+	void sample(const float* filterTable, const float* left, const float* right, double position, float& outLeft, float& outRight) const {
+		long long i = (long long)position;
+		int phase = (int)((position - i) * RESAMPLER_PHASES);
+		const float* h = filterTable + phase * taps;
+		long long first = i + firstTap();
+		outLeft = dotProduct(left + first, h, taps);
+		outRight = dotProduct(right + first, h, taps);
+	}
+
+private:
+	int taps;
+	std::vector<float> coefficients;	// [cutoff][phase][tap]
+};
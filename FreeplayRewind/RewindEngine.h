@@ -0,0 +1,337 @@
+#pragma once
+#include "World.h"
+#include "Settings.h"
+#include "GameState.h"
+#include "SnapshotHistory.h"
+#include "AdaptiveRecorder.h"
+#include "CapturePipeline.h"
+#include "SessionFile.h"
+#include "Profiler.h"
+#include <functional>
+#include <atomic>
+#include <cmath>
+
+
+/*************************************************************************************************************
+ Rewind engine
+
+ Records the game, rewinds it and replays the rewound state, once per physics tick. It only sees the
+ game through a RewindWorld, so the plugin drives it with BakkesWorld and the benchmark with a
+ simulated world. Everything here belongs to the game thread, except the history, the recorder and
+ the changes, which belong to the capture worker until pipeline.drain().
+**************************************************************************************************************/
+
+/* what each capture changed in the ball and the car, fr_stats. Counted by the capture worker */
+struct CaptureChanges {
+	GameFields last = GameFields();	// worker only
+	std::atomic<uint64_t> captures{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };		// of their deltas in the compressed history
+	std::atomic<uint64_t> unchanged{ 0 };	// captures equal to the one before
+};
+
+class RewindEngine
+{
+public:
+	RewindEngine() : overwrite(), replayed(), index(-2), cursor(0.0f), lastRecordTime(0.0f), lastTick(0.0f), previousTimeUnpaused(0.0f),
+		rewinderEnabled(false), rewindForward(false), rewindBackward(false), startShot(true), soundSpeed(1.0f), resets(0),
+		lastTime(-1.0f), ticks(0), collapsed(0) {}
+
+	SnapshotHistory history;		// the recorded game states, sized by fr_rewind_memoryBudget
+	AdaptiveRecorder recorder;		// drops predictable snapshots, fr_rewind_adaptive
+	CapturePipeline pipeline;		// hands the captures to the worker that records them, drain() before using history
+	SessionWriter session;			// every capture, streamed to the session file once started
+
+	GameState overwrite;			// the saved state to replay
+	WorldState replayed;			// what replay sets on the world, kept so that it does not allocate
+	WorldState captured;			// what the last capture read from the world, likewise
+	int index;						// the position of the current state in the history
+	float cursor;					// the time of the current state on the history's clock, index is the snapshot at or before it
+	float lastRecordTime;
+	float lastTick;
+	float previousTimeUnpaused;
+
+	bool rewinderEnabled;
+	bool rewindForward;
+	bool rewindBackward;
+	bool startShot;
+	float soundSpeed;				// the scrub sounds follow the scrub while rewindForward or rewindBackward
+	uint32_t resets;				// clear calls that forgot a shot
+
+	float lastTime;					// game time of the last physics tick the rewind ran for
+	uint64_t ticks;					// PlayerMove calls that ran the rewind, fr_stats
+	uint64_t collapsed;				// the ones skipped because the physics had not stepped since
+	CaptureChanges changes;
+
+	void start() {
+		pipeline.start(std::bind(&RewindEngine::processCapture, this, std::placeholders::_1));
+	}
+
+	/* stops the worker and the session writer, the history may point into a session mapping */
+	void close() {
+		pipeline.close();
+		session.close();
+		history.clear();
+	}
+
+	/* a match starts, PlayerMove may fire with the same game time as in the last one */
+	void restart() {
+		lastTime = -1.0f;
+	}
+
+	/* PlayerMove can fire several times per physics step, the game time only moves once per step */
+	bool isNewTick(float time) {
+		if (time == lastTime) {
+			collapsed++;
+			return false;
+		}
+		lastTime = time;
+		ticks++;
+		return true;
+	}
+
+	/* one PlayerMove of a refreshed world: records the game, or rewinds it while a rewind key is held */
+	void tick(RewindWorld& world, const Settings& settings, int rewindKeyController, int rewindKeyKBM) {
+		// the state of this tick was already captured or applied. The game time stands still in the pause menu
+		bool paused = world.isPaused();
+		if (!paused && !isNewTick(world.secondsElapsed()))
+			return;
+
+		rewindForward = false;
+		rewindBackward = false;
+		rewinderEnabled = false;
+
+
+		if (settings.replayEnabled && world.isBallInGoal())
+			return;
+
+
+		if (!world.isCarMoving()) { // when freeplay is reset (pressing reset shot or after goal if enabled)
+			pipeline.drain();
+			if (history.size() != 0) {
+				history.clear();
+				recorder.reset();
+				endAttempt();
+				index = -1;
+				lastTick = .0f;
+				cursor = .0f;
+				previousTimeUnpaused = 0.0f;
+				//lastRecordTime = 0.0f;
+			}
+			return;
+		}
+
+
+		if (paused) {
+			previousTimeUnpaused = world.secondsElapsed();
+			return;
+		}
+
+
+		ControllerInput carInput = world.carInput();
+
+		if (world.secondsElapsed() < previousTimeUnpaused + 0.25) { // after user unpause freeplay, do this for 0.25 s
+			if (!startShot)
+				if (fabsf(carInput.Throttle) > 0 || fabsf(carInput.Steer) > 0 || carInput.HoldingBoost == 1 || carInput.Jumped == 1)
+					resumeShot(settings);
+
+			if (!startShot) replay(world);
+			else recordGameState(world, settings);
+
+			return;
+		}
+
+		// end check
+
+
+		if (!settings.replayEnabled)
+			world.setGoalEnabled(false);
+
+		if (world.isKeyPressed(rewindKeyController) || world.isKeyPressed(rewindKeyKBM)) {
+
+			rewinderEnabled = true;
+			if (startShot) {	// rewind from the current state, not from the last stored one
+				pipeline.drain();
+				recorder.flush(history);
+				index = history.size() - 1;
+				if (index >= 0) cursor = history.timestamp(index);
+			}
+			startShot = false;
+
+			float steer = fabsf(carInput.Steer);
+
+			// replaying shot or pausing rewind
+			if (steer < settings.rewindDeadzone) {
+				replay(world);
+				return;
+			}
+
+			float rewindSpeed = 0.0f;
+			if (steer > 0.75f)		 rewindSpeed = 0.4f * steer;
+			else if (steer > 0.50f)	 rewindSpeed = 0.3f * steer;
+			else rewindSpeed = 0.2f * steer;
+
+			if (carInput.Steer < -0.01f) {
+				rewindBackward = true;
+				rewindSpeed *= settings.rewindBackwardSpeed;
+			}
+			else {
+				rewindForward = true;
+				rewindSpeed *= settings.rewindForwardSpeed;
+			}
+
+			// the scrub sounds play at their own pitch when the shot goes by in real time
+			soundSpeed = settings.rewindSoundFollowSpeed ? rewindSpeed : 1.0f;
+
+			float currentTimeInMs = world.secondsElapsed();
+			float tickDiff = currentTimeInMs - lastTick;
+			if (fabsf(tickDiff) > .1) {
+				lastTick = currentTimeInMs;
+				tickDiff = .01f;
+			}
+
+			if (history.size() > 1) {
+				float deltaElapsed = tickDiff * fabsf(rewindSpeed);
+				scrubTo(rewindBackward ? cursor - deltaElapsed : cursor + deltaElapsed, settings);
+			}
+			replay(world);
+
+			lastTick = currentTimeInMs;
+		}
+		else {
+			if (!startShot) {
+				if (fabsf(carInput.Throttle) > 0 || fabsf(carInput.Steer) > 0 || carInput.HoldingBoost == 1 || carInput.Jumped == 1)
+					resumeShot(settings);
+			}
+
+			if (settings.replayEnabled)
+				world.setGoalEnabled(true);
+
+			if (!startShot) replay(world);
+			else recordGameState(world, settings);
+		}
+	}
+
+	/* sets the saved state on the world */
+	void replay(RewindWorld& world) {
+		overwrite.apply(world, replayed);
+	}
+
+	/* moves the current state to time, clamped to the recorded span. One binary search however far it is */
+	void scrubTo(float time, const Settings& settings) {
+		float first = history.timestamp(0);
+		float last = history.timestamp(history.size() - 1);
+		cursor = time < first ? first : (time > last ? last : time);
+		index = (int)history.seek(cursor);
+
+		// dropped snapshots can only be rebuilt by the cubic interpolation
+		bool cubic = settings.rewindCubicInterpolation || recorder.isEnabled();
+		if (index + 1 < (int)history.size())
+			overwrite.interpolate(history, index, index + 1, cursor - history.timestamp(index), cubic);
+		else
+			overwrite.interpolate(history, index, index, 0.0f, cubic);
+	}
+
+	/* the player moves again: recording goes on from the rewound state, on a new branch if it was not the last one */
+	void resumeShot(const Settings& settings) {
+		startShot = true;
+		pipeline.drain();
+		if (index >= 0)
+			history.resumeAt(index, settings.rewindSnapshotInterval);
+		recorder.reset();	// its prediction base belongs to the previous branch
+	}
+
+	void recordGameState(RewindWorld& world, const Settings& settings) {
+		FR_PROFILE(PROFILE_RECORD);
+
+		float secondsElapsed = world.secondsElapsed();	// the world was refreshed for this tick
+
+		if (fabsf(secondsElapsed - lastRecordTime) < settings.rewindSnapshotInterval)
+			return;
+
+		// only the world is read here, into the queue, the worker records it. index is set when the history is drained
+		lastRecordTime = secondsElapsed;
+		Capture* capture = pipeline.claim();
+		if (!capture) return;
+		world.capture(captured);
+		capture->kind = Capture::Snapshot;
+		GameState::toFrames(captured, capture->frames);
+		capture->balls = (int)captured.balls.size();
+		capture->cars = (int)captured.cars.size();
+		capture->jump = captured.jump;
+		capture->pads = captured.pads.picked;
+		capture->timestamp = secondsElapsed;
+		pipeline.submit();
+
+		if (overwrite.timestamp == 0 && overwrite.ball_location.Z == 0)	// the first state of the shot
+			overwrite = GameState(captured, secondsElapsed);
+	}
+
+	/* worker thread, the only one touching the history and the recorder until the next drain, and the
+	   only one feeding the session writer */
+	void processCapture(const Capture& capture) {
+		if (capture.kind == Capture::EndAttempt) return session.endAttempt();
+		if (capture.kind == Capture::ClearSession) return session.clear();
+
+		FR_PROFILE(PROFILE_PROCESS);
+		if (capture.balls != history.otherBalls() || capture.cars != history.otherCars()) {
+			history.setBodies(capture.balls, capture.cars);	// a ball or a car came or left, clears the history
+			recorder.reset();
+		}
+
+		recorder.record(capture.frames, capture.timestamp, capture.jump, capture.pads, history);
+		session.append(capture.frames[0], capture.timestamp);	// the session file only keeps the ball and the car
+
+		GameFields fields;
+		unpackFields(fields, capture.frames[0]);
+		changes.captures.fetch_add(1, std::memory_order_relaxed);
+		changes.bytes.fetch_add(deltaBytes(changes.last, fields), std::memory_order_relaxed);
+		if (sameFields(changes.last, fields)) changes.unchanged.fetch_add(1, std::memory_order_relaxed);
+		changes.last = fields;
+	}
+
+	/* the session file is written from the worker, which must be idle while the writer starts or stops */
+	void startSession(const std::string& filename) {
+		pipeline.drain();
+		session.start(filename);
+	}
+
+	void closeSession() {
+		pipeline.drain();
+		session.close();
+	}
+
+	/* the next record of the session file starts a new attempt */
+	void endAttempt() {
+		pipeline.mark(Capture::EndAttempt);
+	}
+
+	/* empties the session file once the snapshots queued before are written, any mapping of it must be
+	   closed first */
+	void clearSession() {
+		pipeline.mark(Capture::ClearSession);
+	}
+
+	/* forgets the shot and the rewind, false if nothing was recorded */
+	bool clear() {
+		pipeline.drain();
+		if (history.size() == 0)
+			return false;
+
+		overwrite = GameState();
+		history.clear();
+		recorder.reset();
+		endAttempt();
+		index = -1;
+		rewinderEnabled = false;
+		rewindForward = false;
+		rewindBackward = false;
+		lastTick = .0f;
+		cursor = .0f;
+
+		previousTimeUnpaused = 0.0f;
+		startShot = true;
+		resets++;
+		//lastRecordTime = 0.0f;
+		return true;
+	}
+};
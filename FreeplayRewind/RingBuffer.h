@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <stdexcept>
+#include <utility>
+
+
+/*************************************************************************************************************
+ Fixed-capacity circular buffer for the rewind history
+
+ Storage is allocated once per capacity change, pushing into a full buffer overwrites the oldest
+ element in O(1), and element 0 is always the oldest one so indices work like a vector's
+**************************************************************************************************************/
+
+template <typename T>
+class RingBuffer
+{
+public:
+	RingBuffer() : head(0), count(0) {}
+
+	explicit RingBuffer(size_t capacity) : head(0), count(0) {
+		setCapacity(capacity);
+	}
+
+	/* keeps the most recent elements that still fit, does nothing if the capacity is unchanged */
+	void setCapacity(size_t capacity) {
+		if (capacity == storage.size()) return;
+
+		std::vector<T> resized(capacity);
+		size_t kept = count < capacity ? count : capacity;
+		for (size_t i = 0; i < kept; i++)
+			resized[i] = std::move((*this)[count - kept + i]);
+
+		storage.swap(resized);
+		head = 0;
+		count = kept;
+	}
+
+	size_t capacity() const { return storage.size(); }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	bool full() const { return count == storage.size(); }
+
+	/* keeps the allocated storage */
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+
+	/* appends at the end, evicting the oldest element if the buffer is full */
+	void push_back(const T& value) {
+		if (storage.empty()) return;
+
+		if (count < storage.size()) {
+			storage[wrap(head + count)] = value;
+			count++;
+		}
+		else {
+			storage[head] = value;
+			head = wrap(head + 1);
+		}
+	}
+
+	void pop_front() {
+		if (count == 0) return;
+		head = wrap(head + 1);
+		count--;
+	}
+
+	T& operator[](size_t i) { return storage[wrap(head + i)]; }
+	const T& operator[](size_t i) const { return storage[wrap(head + i)]; }
+
+	T& at(size_t i) {
+		if (i >= count) throw std::out_of_range("RingBuffer::at");
+		return (*this)[i];
+	}
+
+	const T& at(size_t i) const {
+		if (i >= count) throw std::out_of_range("RingBuffer::at");
+		return (*this)[i];
+	}
+
+	T& front() { return (*this)[0]; }
+	T& back() { return (*this)[count - 1]; }
+
+private:
+	/* head and i are both below the capacity, so one subtraction is enough */
+	size_t wrap(size_t i) const {
+		return i >= storage.size() ? i - storage.size() : i;
+	}
+
+	std::vector<T> storage;
+	size_t head;	// position of the oldest element in storage
+	size_t count;
+};
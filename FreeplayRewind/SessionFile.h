@@ -0,0 +1,355 @@
+#pragma once
+#include "SnapshotFrame.h"
+#include "SpscQueue.h"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/*************************************************************************************************************
+ Session file
+
+ Every captured snapshot is appended to a binary file: a header, then fixed-size records laid out like a
+ SnapshotFrame, so a record can be read in place. The header holds the version, the record count and
+ an index of the attempts (a new one starts whenever the history is cleared).
+ The capture worker (see CapturePipeline) is the only thread calling append, endAttempt and clear: it
+ pushes them into a lock-free queue, a writer thread appends the records and updates the header.
+ Reading maps the file copy-on-write: the history points straight into the mapping, so a session of any
+ length opens instantly and only the pages actually read are loaded.
+ The file stops growing at SESSION_MAX_RECORDS, later records are counted as dropped until
+ fr_session_clear starts it over. Recording is off unless fr_session_enabled is set.
+**************************************************************************************************************/
+
+const uint32_t SESSION_MAGIC = 0x4E535246;	// "FRSN"
+const uint32_t SESSION_VERSION = 2;		// 1 held rotations as pitch, yaw and roll
+const int SESSION_MAX_ATTEMPTS = 1024;		// once full, the last attempt keeps growing
+const uint64_t SESSION_MAX_RECORDS = 1 << 20;	// 144 MB, some 9 hours of play at the default snapshot interval
+
+struct alignas(16) SessionRecord {
+	SnapshotFrame frame;
+	float timestamp;
+	uint32_t reserved[3];
+};
+
+struct SessionAttempt {
+	uint64_t firstRecord;
+	uint32_t recordCount;
+	float startTime;		// seconds elapsed in the game when it was recorded
+};
+
+struct alignas(16) SessionHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerBytes;
+	uint32_t recordBytes;
+	uint64_t recordCount;
+	uint32_t attemptCount;
+	uint32_t maxAttempts;
+	SessionAttempt attempts[SESSION_MAX_ATTEMPTS];
+};
+
+static_assert(sizeof(SessionRecord) % 16 == 0 && sizeof(SessionHeader) % 16 == 0, "session records must stay 16-byte aligned in the mapping");
+static_assert(SESSION_MAX_RECORDS <= UINT32_MAX, "the record count of an attempt is 32 bits");
+
+/* the part of the header before the attempt index */
+const size_t SESSION_HEADER_FIELDS = offsetof(SessionHeader, attempts);
+
+inline bool isValidSessionHeader(const SessionHeader& header) {
+	return header.magic == SESSION_MAGIC && header.version == SESSION_VERSION && header.headerBytes == sizeof(SessionHeader)
+		&& header.recordBytes == sizeof(SessionRecord) && header.maxAttempts == SESSION_MAX_ATTEMPTS
+		&& header.attemptCount <= SESSION_MAX_ATTEMPTS;
+}
+
+inline bool seekFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+
+
+/*************************************************************************************************************
+ Appending, from a writer thread
+**************************************************************************************************************/
+
+class SessionWriter
+{
+public:
+	SessionWriter() : file(nullptr), attemptOpen(false), running(false), dropCount(0), writtenCount(0) {}
+	~SessionWriter() { close(); }
+
+	/* opens or creates the file, a file of another version is started over */
+	bool start(const std::string& filename) {
+		close();
+		path = filename;
+		if (!openFile(false))
+			return false;
+
+		running = true;
+		thread = std::thread(&SessionWriter::run, this);
+		return true;
+	}
+
+	/* writes what is queued, then stops the writer thread */
+	void close() {
+		if (running) {
+			running = false;
+			thread.join();
+		}
+		if (file) {
+			fclose(file);
+			file = nullptr;
+		}
+	}
+
+	bool isOpen() const { return running; }
+	const std::string& filename() const { return path; }
+
+	/* capture worker, never blocks: the record is dropped if the writer is behind */
+	void append(const SnapshotFrame& frame, float timestamp) {
+		if (!running) return;
+		Command command;
+		command.type = Command::Record;
+		command.record.frame = frame;
+		command.record.timestamp = timestamp;
+		if (!commands.push(command))
+			dropCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/* capture worker, like clear: the queue has one producer. The next record starts a new attempt */
+	void endAttempt() {
+		push(Command::EndAttempt);
+	}
+
+	/* empties the file, any mapping of it must be closed first */
+	void clear() {
+		push(Command::Clear);
+	}
+
+	long long dropped() const { return dropCount.load(std::memory_order_relaxed); }
+	long long written() const { return writtenCount.load(std::memory_order_relaxed); }
+
+private:
+	struct Command {
+		enum Type { Record, EndAttempt, Clear } type;
+		SessionRecord record;
+	};
+
+	void push(Command::Type type) {
+		if (!running) return;
+		Command command;
+		command.type = type;
+		while (!commands.push(command))	// markers are rare, the writer frees a slot within a few ms
+			std::this_thread::yield();
+	}
+
+	bool openFile(bool truncate) {
+		if (file) fclose(file);
+		file = truncate ? nullptr : fopen(path.c_str(), "r+b");
+		bool valid = file && fread(&header, sizeof(header), 1, file) == 1 && isValidSessionHeader(header);
+
+		if (!valid) {
+			if (file) fclose(file);
+			file = fopen(path.c_str(), "w+b");
+			if (!file) return false;
+			header = SessionHeader();
+			header.magic = SESSION_MAGIC;
+			header.version = SESSION_VERSION;
+			header.headerBytes = sizeof(SessionHeader);
+			header.recordBytes = sizeof(SessionRecord);
+			header.maxAttempts = SESSION_MAX_ATTEMPTS;
+			fwrite(&header, sizeof(header), 1, file);
+			fflush(file);
+		}
+
+		// a torn record after a crash is overwritten by the next one
+		seekFile(file, sizeof(SessionHeader) + header.recordCount * sizeof(SessionRecord));
+		attemptOpen = false;
+		return true;
+	}
+
+	void run() {
+		const std::chrono::milliseconds headerInterval(100);
+		std::chrono::steady_clock::time_point lastHeader = std::chrono::steady_clock::now();
+		bool dirty = false;
+
+		for (;;) {
+			bool stopping = !running;	// read before draining, so nothing pushed before close is lost
+			Command command;
+			while (commands.pop(command)) {
+				if (!file) continue;
+				if (command.type == Command::Record) {
+					write(command.record);
+					dirty = true;
+				}
+				else {
+					if (dirty) writeHeader();
+					dirty = false;
+					if (command.type == Command::Clear && !openFile(true)) file = nullptr;
+					attemptOpen = false;
+				}
+			}
+
+			if (dirty && (stopping || std::chrono::steady_clock::now() - lastHeader > headerInterval)) {
+				writeHeader();
+				dirty = false;
+				lastHeader = std::chrono::steady_clock::now();
+			}
+
+			if (stopping) return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+
+	void write(const SessionRecord& record) {
+		if (header.recordCount >= SESSION_MAX_RECORDS) {
+			dropCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		if (!attemptOpen) {
+			if (header.attemptCount < SESSION_MAX_ATTEMPTS)
+				header.attempts[header.attemptCount++] = SessionAttempt{ header.recordCount, 0, record.timestamp };
+			attemptOpen = true;
+		}
+
+		if (fwrite(&record, sizeof(record), 1, file) != 1) return;
+		header.recordCount++;
+		if (header.attemptCount > 0)
+			header.attempts[header.attemptCount - 1].recordCount++;
+		writtenCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/* records first, so the header never counts a record that is not on disk */
+	void writeHeader() {
+		fflush(file);
+		seekFile(file, 0);
+		fwrite(&header, SESSION_HEADER_FIELDS, 1, file);
+		if (header.attemptCount > 0) {
+			size_t last = header.attemptCount - 1;
+			seekFile(file, SESSION_HEADER_FIELDS + last * sizeof(SessionAttempt));
+			fwrite(&header.attempts[last], sizeof(SessionAttempt), 1, file);
+		}
+		fflush(file);
+		seekFile(file, sizeof(SessionHeader) + header.recordCount * sizeof(SessionRecord));
+	}
+
+	std::string path;
+	FILE* file;
+	SessionHeader header;	// writer thread
+	bool attemptOpen;
+
+	SpscQueue<Command, 1024> commands;
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<long long> dropCount;
+	std::atomic<long long> writtenCount;
+};
+
+
+
+/*************************************************************************************************************
+ Reading, through a copy-on-write mapping
+**************************************************************************************************************/
+
+class SessionMapping
+{
+public:
+	SessionMapping() : base(nullptr), bytes(0), recordCount(0) {
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#endif
+	}
+
+	~SessionMapping() { close(); }
+
+	/* maps what the writer has flushed so far, false if the file is missing or of another version */
+	bool open(const std::string& filename) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || (uint64_t)size.QuadPart < sizeof(SessionHeader)) {
+			close();
+			return false;
+		}
+		bytes = (size_t)size.QuadPart;
+		mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (mapping) base = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, bytes);
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= sizeof(SessionHeader)) {
+			bytes = (size_t)st.st_size;
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			base = p == MAP_FAILED ? nullptr : (uint8_t*)p;
+		}
+		::close(fd);
+#endif
+		if (!base || !isValidSessionHeader(header())) {
+			close();
+			return false;
+		}
+
+		// the header may have been written while the last records were still in flight
+		size_t mapped = (bytes - sizeof(SessionHeader)) / sizeof(SessionRecord);
+		recordCount = header().recordCount < mapped ? (size_t)header().recordCount : mapped;
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (base) UnmapViewOfFile(base);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#else
+		if (base) munmap(base, bytes);
+#endif
+		base = nullptr;
+		bytes = 0;
+		recordCount = 0;
+	}
+
+	bool isOpen() const { return base != nullptr; }
+	size_t size() const { return recordCount; }
+	int attemptCount() const { return isOpen() ? (int)header().attemptCount : 0; }
+
+	/* clamped to the mapped records */
+	SessionAttempt attempt(int i) const {
+		SessionAttempt a = header().attempts[i];
+		if (a.firstRecord > recordCount) a.firstRecord = recordCount;
+		if (a.firstRecord + a.recordCount > recordCount) a.recordCount = (uint32_t)(recordCount - a.firstRecord);
+		return a;
+	}
+
+	SessionRecord* records() { return (SessionRecord*)(base + sizeof(SessionHeader)); }
+
+private:
+	const SessionHeader& header() const { return *(const SessionHeader*)base; }
+
+	uint8_t* base;
+	size_t bytes;
+	size_t recordCount;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
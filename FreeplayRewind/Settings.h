@@ -0,0 +1,199 @@
+#pragma once
+#include <string>
+
+
+/*************************************************************************************************************
+ Settings schema
+
+ Every cvar of the plugin is described once in SETTINGS (and the color cvars in COLOR_ELEMENTS).
+ Registration, the *_default notifiers and the color editor are generated from these tables, and each
+ cvar writes its value into a plain Settings struct when it changes, so the tick and render paths
+ never look a cvar up by name.
+**************************************************************************************************************/
+
+struct RGB {
+	int R;
+	int G;
+	int B;
+};
+
+enum ColorElement {
+	COLOR_FILTER,
+	COLOR_BACKWARD_ACTIVE,
+	COLOR_BACKWARD_INACTIVE,
+	COLOR_FORWARD_ACTIVE,
+	COLOR_FORWARD_INACTIVE,
+	COLOR_PAUSE_ACTIVE,
+	COLOR_PAUSE_INACTIVE,
+	COLOR_PLAY,
+	COLOR_SHADOW,
+	COLOR_ELEMENT_COUNT
+};
+
+struct Settings {
+	bool enabled;
+
+	// rewind
+	bool rewindBackwardSound, rewindForwardSound, rewindPauseSound, rewindPlaySound;
+	bool rewindSoundFollowSpeed;
+	int rewindSoundQuality;
+	float rewindMemoryBudget;
+	bool rewindCompressHistory;
+	float rewindBackwardSpeed, rewindForwardSpeed, rewindDeadzone;
+	float rewindSnapshotInterval;
+	bool rewindCubicInterpolation, rewindAdaptive;
+	float rewindAdaptiveTolerance;
+
+	// filter
+	bool filterShow, filterRewindLines;
+	int filterOpacity, filterFadeSpeed, filterShake;
+
+	// icons
+	bool iconsShow, iconsAutoHide, iconsFixedPosition, iconsShake, iconsGuidelines;
+	int iconsPositionX, iconsPositionY;
+	float iconsSize;
+
+	// colors
+	std::string colorElement;
+	RGB colors[COLOR_ELEMENT_COUNT];
+
+	// extra
+	bool replayEnabled, switchPovEnabled;
+
+	// stats
+	bool statsEnabled, statsGraph;
+
+	// session file
+	bool sessionEnabled;
+};
+
+
+enum class SettingType { Bool, Int, Float, String };
+
+enum class SettingGroup { Plugin, Rewind, Filter, Icons, Colors, Extra };
+
+struct SettingInfo {
+	const char* name;
+	SettingType type;
+	const char* defaultValue;
+	bool hasMin;
+	float min;
+	bool hasMax;
+	float max;
+	bool save;				// saved to the config file
+	bool defaultNotifier;	// registers <name>_default
+	SettingGroup group;
+
+	// where the value goes in Settings, only the one matching type is set (none for UI-only cvars)
+	bool Settings::* boolMember;
+	int Settings::* intMember;
+	float Settings::* floatMember;
+	std::string Settings::* stringMember;
+};
+
+constexpr SettingInfo boolSetting(const char* name, const char* defaultValue, bool Settings::* member, SettingGroup group) {
+	return SettingInfo{ name, SettingType::Bool, defaultValue, true, 0, true, 1, true, false, group, member, nullptr, nullptr, nullptr };
+}
+
+constexpr SettingInfo intSetting(const char* name, const char* defaultValue, float min, float max, int Settings::* member,
+	SettingGroup group, bool defaultNotifier = false, bool save = true) {
+	return SettingInfo{ name, SettingType::Int, defaultValue, true, min, true, max, save, defaultNotifier, group, nullptr, member, nullptr, nullptr };
+}
+
+constexpr SettingInfo floatSetting(const char* name, const char* defaultValue, float min, float max, float Settings::* member,
+	SettingGroup group, bool defaultNotifier = false) {
+	return SettingInfo{ name, SettingType::Float, defaultValue, true, min, true, max, true, defaultNotifier, group, nullptr, nullptr, member, nullptr };
+}
+
+constexpr SettingInfo stringSetting(const char* name, const char* defaultValue, std::string Settings::* member, SettingGroup group, bool save = true) {
+	return SettingInfo{ name, SettingType::String, defaultValue, false, 0, false, 0, save, false, group, nullptr, nullptr, nullptr, member };
+}
+
+constexpr SettingInfo SETTINGS[] = {
+	/* Enable plugin and rewind button/key */
+	boolSetting("fr_enabled", "1", &Settings::enabled, SettingGroup::Plugin),
+	stringSetting("fr_rewindKeyController", "XboxTypeS_LeftShoulder", nullptr, SettingGroup::Plugin),
+	stringSetting("fr_rewindKeyKBM", "R", nullptr, SettingGroup::Plugin),
+	stringSetting("fr_bindKeyStatus", "Click here to quickly bind your rewind button/key", nullptr, SettingGroup::Plugin, false),
+
+	/* rewind settings */
+	boolSetting("fr_rewind_backwardSound", "1", &Settings::rewindBackwardSound, SettingGroup::Rewind),
+	boolSetting("fr_rewind_forwardSound", "1", &Settings::rewindForwardSound, SettingGroup::Rewind),
+	boolSetting("fr_rewind_pauseSound", "1", &Settings::rewindPauseSound, SettingGroup::Rewind),
+	boolSetting("fr_rewind_playSound", "1", &Settings::rewindPlaySound, SettingGroup::Rewind),
+	boolSetting("fr_rewind_soundFollowSpeed", "1", &Settings::rewindSoundFollowSpeed, SettingGroup::Rewind),
+	intSetting("fr_rewind_soundQuality", "1", 0, 2, &Settings::rewindSoundQuality, SettingGroup::Rewind), // resampler taps: 8, 16, 32
+	floatSetting("fr_rewind_memoryBudget", "0.05", 0.01f, 2.0f, &Settings::rewindMemoryBudget, SettingGroup::Rewind, true), // in MB
+	boolSetting("fr_rewind_compressHistory", "1", &Settings::rewindCompressHistory, SettingGroup::Rewind),
+	floatSetting("fr_rewind_backwardSpeed", "3.0", 1.0f, 7.0f, &Settings::rewindBackwardSpeed, SettingGroup::Rewind, true),
+	floatSetting("fr_rewind_forwardSpeed", "2.5", 1.0f, 7.0f, &Settings::rewindForwardSpeed, SettingGroup::Rewind, true),
+	floatSetting("fr_rewind_deadzone", "0.05", 0.01f, 0.50f, &Settings::rewindDeadzone, SettingGroup::Rewind, true),
+	floatSetting("fr_rewind_snapshotInterval", "0.030", 0.015f, 0.100f, &Settings::rewindSnapshotInterval, SettingGroup::Rewind, true),
+	boolSetting("fr_rewind_cubicInterpolation", "1", &Settings::rewindCubicInterpolation, SettingGroup::Rewind),
+	boolSetting("fr_rewind_adaptive", "1", &Settings::rewindAdaptive, SettingGroup::Rewind),
+	floatSetting("fr_rewind_adaptiveTolerance", "2.0", 0.5f, 20.0f, &Settings::rewindAdaptiveTolerance, SettingGroup::Rewind, true), // in uu
+
+	/* filter settings */
+	boolSetting("fr_filter_show", "1", &Settings::filterShow, SettingGroup::Filter),
+	boolSetting("fr_filter_rewindLines", "1", &Settings::filterRewindLines, SettingGroup::Filter),
+	intSetting("fr_filter_opacity", "60", 0, 110, &Settings::filterOpacity, SettingGroup::Filter, true),
+	intSetting("fr_filter_fadeSpeed", "15", 1, 100, &Settings::filterFadeSpeed, SettingGroup::Filter, true),
+	intSetting("fr_filter_shake", "25", 0, 100, &Settings::filterShake, SettingGroup::Filter, true),
+
+	/* icons settings */
+	boolSetting("fr_icons_show", "1", &Settings::iconsShow, SettingGroup::Icons),
+	boolSetting("fr_icons_autoHide", "1", &Settings::iconsAutoHide, SettingGroup::Icons),
+	boolSetting("fr_icons_fixedPosition", "1", &Settings::iconsFixedPosition, SettingGroup::Icons),
+	boolSetting("fr_icons_shake", "1", &Settings::iconsShake, SettingGroup::Icons),
+	boolSetting("fr_icons_guidelines", "0", &Settings::iconsGuidelines, SettingGroup::Icons),
+	intSetting("fr_icons_positionX", "83", 0, 100, &Settings::iconsPositionX, SettingGroup::Icons, true),
+	intSetting("fr_icons_positionY", "13", 0, 100, &Settings::iconsPositionY, SettingGroup::Icons, true),
+	floatSetting("fr_icons_size", "1.8", 0.3f, 3.0f, &Settings::iconsSize, SettingGroup::Icons, true),
+
+	/* color editor, the edited values are stored in the COLOR_ELEMENTS cvars */
+	stringSetting("fr_color_element", "Filter", &Settings::colorElement, SettingGroup::Colors, false),
+	intSetting("fr_color_elementR", "0", 0, 255, nullptr, SettingGroup::Colors, false, false),
+	intSetting("fr_color_elementG", "0", 0, 255, nullptr, SettingGroup::Colors, false, false),
+	intSetting("fr_color_elementB", "0", 0, 255, nullptr, SettingGroup::Colors, false, false),
+
+	// extra settings
+	boolSetting("fr_replay_enabled", "1", &Settings::replayEnabled, SettingGroup::Extra),
+	boolSetting("fr_switchpov_enabled", "1", &Settings::switchPovEnabled, SettingGroup::Extra),
+
+	// timings, see fr_stats
+	boolSetting("fr_stats_enabled", "0", &Settings::statsEnabled, SettingGroup::Extra),
+	boolSetting("fr_stats_graph", "0", &Settings::statsGraph, SettingGroup::Extra),
+
+	// every snapshot streamed to disk, see fr_session_load
+	boolSetting("fr_session_enabled", "0", &Settings::sessionEnabled, SettingGroup::Extra),
+};
+
+
+struct ColorElementInfo {
+	const char* label;		// as shown by fr_color_element
+	const char* cvarPrefix;	// followed by R, G or B
+	RGB defaultValue;
+};
+
+constexpr ColorElementInfo COLOR_ELEMENTS[COLOR_ELEMENT_COUNT] = {
+	{ "Filter", "fr_color_filter", { 130, 80, 15 } },
+	{ "Backward active", "fr_color_backwardActive", { 220, 210, 190 } },
+	{ "Backward inactive", "fr_color_backwardInactive", { 185, 180, 175 } },
+	{ "Forward active", "fr_color_forwardActive", { 220, 210, 190 } },
+	{ "Forward inactive", "fr_color_forwardInactive", { 185, 180, 175 } },
+	{ "Pause active", "fr_color_pauseActive", { 220, 210, 190 } },
+	{ "Pause inactive", "fr_color_pauseInactive", { 185, 180, 175 } },
+	{ "Play", "fr_color_play", { 220, 210, 190 } },
+	{ "Shadow", "fr_color_shadow", { 60, 60, 60 } },
+};
+
+const char* const COLOR_CHANNELS[3] = { "R", "G", "B" };
+constexpr int RGB::* COLOR_CHANNEL_MEMBERS[3] = { &RGB::R, &RGB::G, &RGB::B };
+
+/* returns COLOR_SHADOW for unknown labels, like the color editor always did */
+inline ColorElement colorElementByLabel(const std::string& label) {
+	for (int i = 0; i < COLOR_ELEMENT_COUNT; i++)
+		if (label == COLOR_ELEMENTS[i].label)
+			return (ColorElement)i;
+	return COLOR_SHADOW;
+}
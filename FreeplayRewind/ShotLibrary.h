@@ -0,0 +1,248 @@
+#pragma once
+#include "SnapshotFrame.h"
+#include "SessionFile.h"
+#include "Quaternion.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ Named shot library
+
+ One file: a header, an open-addressing hash table of the names, then fixed-size records holding a name
+ and a SnapshotFrame. Nothing is read when the plugin loads; saving or loading a shot reads the header,
+ probes a few slots and reads or writes one record, however many shots are stored. The table doubles
+ (and the file is rewritten) when it gets 70% full. A library of an older version is read as is and
+ rewritten in the current one on the next save.
+**************************************************************************************************************/
+
+const uint32_t SHOT_MAGIC = 0x48535246;	// "FRSH"
+const uint32_t SHOT_VERSION = 2;		// 1 held rotations as pitch, yaw and roll
+const uint32_t SHOT_INITIAL_SLOTS = 256;
+const int SHOT_NAME_LENGTH = 47;
+
+struct alignas(16) ShotRecord {
+	char name[SHOT_NAME_LENGTH + 1];	// zero-terminated
+	SnapshotFrame frame;
+};
+
+struct ShotSlot {
+	uint32_t hash;
+	uint32_t record;	// record index + 1, 0 for an empty slot
+};
+
+struct ShotHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordBytes;
+	uint32_t slotCount;		// a power of two
+	uint32_t recordCount;
+	uint32_t reserved[3];
+};
+
+/* FNV-1a */
+inline uint32_t hashShotName(const char* name) {
+	uint32_t hash = 2166136261u;
+	for (; *name; name++)
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+	return hash;
+}
+
+
+class ShotLibrary
+{
+public:
+	explicit ShotLibrary(const std::string& filename) : path(filename) {}
+
+	static bool isValidName(const std::string& name) {
+		return !name.empty() && name.size() <= SHOT_NAME_LENGTH;
+	}
+
+	/* replaces the shot with the same name */
+	bool save(const std::string& name, const SnapshotFrame& frame) {
+		if (!isValidName(name)) return false;
+		FILE* file = fopen(path.c_str(), "r+b");
+		ShotHeader header;
+		if (!file || !readHeader(file, header)) {
+			if (file) fclose(file);
+			if (!create(path, SHOT_INITIAL_SLOTS, std::vector<ShotRecord>())) return false;
+			file = fopen(path.c_str(), "r+b");
+			if (!file || !readHeader(file, header)) {
+				if (file) fclose(file);
+				return false;
+			}
+		}
+
+		// an older library is rewritten first, a record of the current version must not land among old ones
+		if (header.version != SHOT_VERSION) {
+			fclose(file);
+			if (!rebuild(header.slotCount)) return false;
+			return save(name, frame);
+		}
+
+		ShotRecord record = ShotRecord();
+		strncpy(record.name, name.c_str(), SHOT_NAME_LENGTH);
+		record.frame = frame;
+		uint32_t hash = hashShotName(record.name);
+		uint32_t slot = 0, found = 0;
+
+		if (find(file, header, record.name, hash, slot, found)) {
+			bool ok = writeRecord(file, header, found, record);
+			fclose(file);
+			return ok;
+		}
+
+		if ((uint64_t)(header.recordCount + 1) * 10 > (uint64_t)header.slotCount * 7) {
+			fclose(file);
+			if (!rebuild(header.slotCount * 2)) return false;
+			return save(name, frame);
+		}
+
+		// record first, so an interrupted save leaves at worst an unreferenced record
+		ShotSlot entry = { hash, header.recordCount + 1 };
+		bool ok = writeRecord(file, header, header.recordCount, record)
+			&& seekFile(file, slotOffset(slot)) && fwrite(&entry, sizeof(entry), 1, file) == 1;
+		if (ok) {
+			header.recordCount++;
+			ok = seekFile(file, 0) && fwrite(&header, sizeof(header), 1, file) == 1;
+		}
+		fclose(file);
+		return ok;
+	}
+
+	bool load(const std::string& name, SnapshotFrame& frame) const {
+		if (!isValidName(name)) return false;
+		FILE* file = fopen(path.c_str(), "rb");
+		ShotHeader header;
+		uint32_t slot = 0, found = 0;
+		ShotRecord record;
+		bool ok = file && readHeader(file, header) && find(file, header, name.c_str(), hashShotName(name.c_str()), slot, found)
+			&& seekFile(file, recordOffset(header, found)) && fread(&record, sizeof(record), 1, file) == 1;
+		if (file) fclose(file);
+		if (ok) {
+			upgrade(record, header.version);
+			frame = record.frame;
+		}
+		return ok;
+	}
+
+	/* names in the order they were first saved */
+	std::vector<std::string> list() const {
+		std::vector<std::string> names;
+		std::vector<ShotRecord> records;
+		if (readRecords(records))
+			for (const ShotRecord& record : records)
+				names.push_back(record.name);
+		return names;
+	}
+
+private:
+	static uint64_t slotOffset(uint32_t slot) { return sizeof(ShotHeader) + (uint64_t)slot * sizeof(ShotSlot); }
+
+	static uint64_t recordOffset(const ShotHeader& header, uint32_t record) {
+		return slotOffset(header.slotCount) + (uint64_t)record * sizeof(ShotRecord);
+	}
+
+	static bool readHeader(FILE* file, ShotHeader& header) {
+		return seekFile(file, 0) && fread(&header, sizeof(header), 1, file) == 1 && header.magic == SHOT_MAGIC
+			&& (header.version == 1 || header.version == SHOT_VERSION) && header.recordBytes == sizeof(ShotRecord)
+			&& header.slotCount != 0 && (header.slotCount & (header.slotCount - 1)) == 0 && header.recordCount < header.slotCount;
+	}
+
+	/* linear probing. Returns the record of that name, or false and the empty slot it would go in */
+	static bool find(FILE* file, const ShotHeader& header, const char* name, uint32_t hash, uint32_t& slot, uint32_t& record) {
+		for (uint32_t probe = 0; probe < header.slotCount; probe++) {
+			slot = (hash + probe) & (header.slotCount - 1);
+			ShotSlot entry;
+			if (!seekFile(file, slotOffset(slot)) || fread(&entry, sizeof(entry), 1, file) != 1 || entry.record == 0)
+				return false;
+			if (entry.hash != hash) continue;
+
+			ShotRecord candidate;
+			if (seekFile(file, recordOffset(header, entry.record - 1)) && fread(&candidate, sizeof(candidate), 1, file) == 1
+				&& strncmp(candidate.name, name, SHOT_NAME_LENGTH + 1) == 0) {
+				record = entry.record - 1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool writeRecord(FILE* file, const ShotHeader& header, uint32_t index, const ShotRecord& record) {
+		return seekFile(file, recordOffset(header, index)) && fwrite(&record, sizeof(record), 1, file) == 1 && fflush(file) == 0;
+	}
+
+	bool readRecords(std::vector<ShotRecord>& records) const {
+		FILE* file = fopen(path.c_str(), "rb");
+		ShotHeader header;
+		bool ok = file && readHeader(file, header);
+		if (ok) {
+			records.resize(header.recordCount);
+			ok = seekFile(file, recordOffset(header, 0))
+				&& (records.empty() || fread(records.data(), sizeof(ShotRecord), records.size(), file) == records.size());
+			for (ShotRecord& record : records)
+				upgrade(record, header.version);
+		}
+		if (file) fclose(file);
+		return ok;
+	}
+
+	/* writes a whole library, the records keep their order */
+	static bool create(const std::string& filename, uint32_t slotCount, const std::vector<ShotRecord>& records) {
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (!file) return false;
+
+		ShotHeader header = ShotHeader();
+		header.magic = SHOT_MAGIC;
+		header.version = SHOT_VERSION;
+		header.recordBytes = sizeof(ShotRecord);
+		header.slotCount = slotCount;
+		header.recordCount = (uint32_t)records.size();
+
+		std::vector<ShotSlot> slots(slotCount, ShotSlot{ 0, 0 });
+		for (uint32_t i = 0; i < records.size(); i++) {
+			uint32_t hash = hashShotName(records[i].name);
+			uint32_t slot = hash & (slotCount - 1);
+			while (slots[slot].record != 0)
+				slot = (slot + 1) & (slotCount - 1);
+			slots[slot] = ShotSlot{ hash, i + 1 };
+		}
+
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(slots.data(), sizeof(ShotSlot), slots.size(), file) == slots.size()
+			&& (records.empty() || fwrite(records.data(), sizeof(ShotRecord), records.size(), file) == records.size());
+		return fclose(file) == 0 && ok;
+	}
+
+	/* converts a record of an older version */
+	static void upgrade(ShotRecord& record, uint32_t version) {
+		if (version != 1) return;
+		for (int body = 0; body < SNAPSHOT_BODIES; body++) {
+			float* lane = record.frame.rotation.v + 4 * body;
+			Quaternion q = quaternionFromRotation((int)lroundf(lane[0]), (int)lroundf(lane[1]), (int)lroundf(lane[2]));
+			lane[0] = q.x;
+			lane[1] = q.y;
+			lane[2] = q.z;
+			lane[3] = q.w;
+		}
+	}
+
+	/* rewrites the file in the current version with slotCount slots, through a temporary file so a failure
+	   loses nothing. The library is replaced in one step, there is no moment without it */
+	bool rebuild(uint32_t slotCount) {
+		std::vector<ShotRecord> records;
+		if (!readRecords(records)) return false;
+
+		std::string temporary = path + ".tmp";
+		if (!create(temporary, slotCount, records)) return false;
+#ifdef _WIN32
+		return MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(temporary.c_str(), path.c_str()) == 0;	// replaces the file atomically
+#endif
+	}
+
+	std::string path;
+};
@@ -0,0 +1,232 @@
+#pragma once
+#include <immintrin.h>
+#include <cstddef>
+#include <cmath>
+
+
+/*************************************************************************************************************
+ Columnar snapshot layout
+
+ Each channel holds one lane of 4 floats per body (x, y, z, w), ball first then car, so a whole channel
+ of a snapshot is 8 contiguous floats: one AVX register or two SSE registers.
+ The car's boost amount rides in the w lane of its angular velocity, rotations are unit quaternions.
+
+ When the server has more balls or cars, a snapshot is a run of frames called pages: the first one
+ holds the ball and the local car, the next ones the other balls then the other cars, two per page.
+ Every page is interpolated by the same kernels, so the cost grows linearly with the bodies.
+**************************************************************************************************************/
+
+const int SNAPSHOT_BALL = 0;
+const int SNAPSHOT_CAR = 1;
+const int SNAPSHOT_BODIES = 2;
+const int SNAPSHOT_MAX_PAGES = 16;		// the ball, the car and up to 30 other bodies
+const int SNAPSHOT_CHANNEL_WIDTH = 4 * SNAPSHOT_BODIES;
+const float SNAPSHOT_NLERP_MIN_DOT = 0.95f;		// closer rotations are blended by nlerp, farther ones (over 36 degrees) by slerp
+
+struct alignas(16) SnapshotChannel {
+	float v[SNAPSHOT_CHANNEL_WIDTH];
+};
+
+struct alignas(16) SnapshotFrame {
+	SnapshotChannel location;
+	SnapshotChannel velocity;
+	SnapshotChannel angularVelocity;
+	SnapshotChannel rotation;
+};
+
+/* pages needed for the ball, the local car and the other bodies */
+inline int snapshotPages(int otherBodies) {
+	int pages = 1 + (otherBodies + 1) / SNAPSHOT_BODIES;
+	return pages < SNAPSHOT_MAX_PAGES ? pages : SNAPSHOT_MAX_PAGES;
+}
+
+/* points at the channels of one snapshot page, wherever they are stored */
+struct SnapshotView {
+	const SnapshotChannel* location;
+	const SnapshotChannel* velocity;
+	const SnapshotChannel* angularVelocity;
+	const SnapshotChannel* rotation;
+
+	static SnapshotView of(const SnapshotFrame& frame) {
+		return SnapshotView{ &frame.location, &frame.velocity, &frame.angularVelocity, &frame.rotation };
+	}
+};
+
+
+
+/*************************************************************************************************************
+ Interpolation kernels: lhs + (rhs - lhs) * t on every lane. Rotations take the shortest way around and
+ are normalized again (nlerp), which only drifts from a constant turn rate when they are far apart:
+ those bodies are redone by slerp.
+ The length of a blend of unit quaternions follows from their dot product, 1 - 2t(1 - t)(1 - |dot|)
+ squared, so the kernel needs a single dot product, and it is at least 1/2: a reciprocal square root
+ estimate and one Newton step replace the square root and the division. Empty lanes stay 0.
+**************************************************************************************************************/
+
+/* spherical interpolation of the quaternion of one body */
+inline void slerpLane(const float* a, const float* b, float t, float* out) {
+	float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	if (dot == 0.0f) return;	// an empty lane
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
+	float angle = acosf(fminf(dot * sign, 1.0f));
+	float s = sinf(angle);
+	if (s < 1e-6f) return;
+	float wa = sinf((1.0f - t) * angle) / s;
+	float wb = sign * sinf(t * angle) / s;
+	for (int i = 0; i < 4; i++)
+		out[i] = wa * a[i] + wb * b[i];
+}
+
+#if defined(__AVX__)
+
+inline void lerpChannel(const SnapshotChannel& lhs, const SnapshotChannel& rhs, __m256 t, SnapshotChannel& out) {
+	__m256 a = _mm256_loadu_ps(lhs.v);
+	__m256 b = _mm256_loadu_ps(rhs.v);
+	_mm256_storeu_ps(out.v, _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t)));
+}
+
+/* the sum of the 4 lanes of each body of a * b, in each of its lanes (dpps is slow on AMD) */
+inline __m256 dot4(__m256 a, __m256 b) {
+	__m256 m = _mm256_mul_ps(a, b);
+	m = _mm256_add_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm256_add_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+/* 1 / sqrt(n) to about 23 bits, for n from 1/2 to 1 */
+inline __m256 inverseLength(__m256 n) {
+	__m256 y = _mm256_rsqrt_ps(n);
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(n, y), y)));
+}
+
+inline void nlerpRotationChannel(const SnapshotChannel& lhs, const SnapshotChannel& rhs, float t, SnapshotChannel& out) {
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 a = _mm256_loadu_ps(lhs.v);
+	__m256 b = _mm256_loadu_ps(rhs.v);
+	__m256 dot = dot4(a, b);
+	__m256 cosine = _mm256_andnot_ps(sign, dot);
+	b = _mm256_xor_ps(b, _mm256_and_ps(dot, sign));		// -b is the same rotation, the other way around
+	__m256 r = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), _mm256_set1_ps(t)));
+	__m256 squared = _mm256_sub_ps(one, _mm256_mul_ps(_mm256_set1_ps(2.0f * t * (1.0f - t)), _mm256_sub_ps(one, cosine)));
+	_mm256_storeu_ps(out.v, _mm256_mul_ps(r, inverseLength(squared)));
+
+	int far = _mm256_movemask_ps(_mm256_cmp_ps(cosine, _mm256_set1_ps(SNAPSHOT_NLERP_MIN_DOT), _CMP_LT_OQ));
+	for (int body = 0; body < SNAPSHOT_BODIES; body++)
+		if (far & (1 << 4 * body)) slerpLane(lhs.v + 4 * body, rhs.v + 4 * body, t, out.v + 4 * body);
+}
+
+inline void interpolateSnapshots(const SnapshotView* lhs, const SnapshotView* rhs, const float* t, SnapshotFrame* out, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		__m256 vt = _mm256_set1_ps(t[i]);
+		lerpChannel(*lhs[i].location, *rhs[i].location, vt, out[i].location);
+		lerpChannel(*lhs[i].velocity, *rhs[i].velocity, vt, out[i].velocity);
+		lerpChannel(*lhs[i].angularVelocity, *rhs[i].angularVelocity, vt, out[i].angularVelocity);
+		nlerpRotationChannel(*lhs[i].rotation, *rhs[i].rotation, t[i], out[i].rotation);
+	}
+}
+
+#else
+
+inline void lerpChannel(const SnapshotChannel& lhs, const SnapshotChannel& rhs, __m128 t, SnapshotChannel& out) {
+	for (int i = 0; i < SNAPSHOT_CHANNEL_WIDTH; i += 4) {
+		__m128 a = _mm_loadu_ps(lhs.v + i);
+		__m128 b = _mm_loadu_ps(rhs.v + i);
+		_mm_storeu_ps(out.v + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+	}
+}
+
+/* 1 / sqrt(n) to about 23 bits, for n from 1/2 to 1 */
+inline __m128 inverseLength(__m128 n) {
+	__m128 y = _mm_rsqrt_ps(n);
+	return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(n, y), y)));
+}
+
+/* both bodies at once: their dot products and lengths share one register, lanes 0 and 1 */
+inline void nlerpRotationChannel(const SnapshotChannel& lhs, const SnapshotChannel& rhs, float t, SnapshotChannel& out) {
+	static_assert(SNAPSHOT_BODIES == 2, "one register holds the dot product of each body");
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 vt = _mm_set1_ps(t);
+	__m128 a0 = _mm_loadu_ps(lhs.v), a1 = _mm_loadu_ps(lhs.v + 4);
+	__m128 b0 = _mm_loadu_ps(rhs.v), b1 = _mm_loadu_ps(rhs.v + 4);
+
+	__m128 m0 = _mm_mul_ps(a0, b0), m1 = _mm_mul_ps(a1, b1);
+	__m128 sums = _mm_add_ps(_mm_unpacklo_ps(m0, m1), _mm_unpackhi_ps(m0, m1));
+	__m128 dots = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+	__m128 cosines = _mm_andnot_ps(sign, dots);
+	__m128 squared = _mm_sub_ps(one, _mm_mul_ps(_mm_set1_ps(2.0f * t * (1.0f - t)), _mm_sub_ps(one, cosines)));
+	__m128 inverse = inverseLength(squared);
+
+	__m128 signs = _mm_and_ps(dots, sign);		// -b is the same rotation, the other way around
+	b0 = _mm_xor_ps(b0, _mm_shuffle_ps(signs, signs, _MM_SHUFFLE(0, 0, 0, 0)));
+	b1 = _mm_xor_ps(b1, _mm_shuffle_ps(signs, signs, _MM_SHUFFLE(1, 1, 1, 1)));
+	__m128 r0 = _mm_add_ps(a0, _mm_mul_ps(_mm_sub_ps(b0, a0), vt));
+	__m128 r1 = _mm_add_ps(a1, _mm_mul_ps(_mm_sub_ps(b1, a1), vt));
+	_mm_storeu_ps(out.v, _mm_mul_ps(r0, _mm_shuffle_ps(inverse, inverse, _MM_SHUFFLE(0, 0, 0, 0))));
+	_mm_storeu_ps(out.v + 4, _mm_mul_ps(r1, _mm_shuffle_ps(inverse, inverse, _MM_SHUFFLE(1, 1, 1, 1))));
+
+	int far = _mm_movemask_ps(_mm_cmplt_ps(cosines, _mm_set1_ps(SNAPSHOT_NLERP_MIN_DOT)));
+	for (int body = 0; body < SNAPSHOT_BODIES; body++)
+		if (far & (1 << body)) slerpLane(lhs.v + 4 * body, rhs.v + 4 * body, t, out.v + 4 * body);
+}
+
+inline void interpolateSnapshots(const SnapshotView* lhs, const SnapshotView* rhs, const float* t, SnapshotFrame* out, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		__m128 vt = _mm_set1_ps(t[i]);
+		lerpChannel(*lhs[i].location, *rhs[i].location, vt, out[i].location);
+		lerpChannel(*lhs[i].velocity, *rhs[i].velocity, vt, out[i].velocity);
+		lerpChannel(*lhs[i].angularVelocity, *rhs[i].angularVelocity, vt, out[i].angularVelocity);
+		nlerpRotationChannel(*lhs[i].rotation, *rhs[i].rotation, t[i], out[i].rotation);
+	}
+}
+
+#endif
+
+inline void interpolateSnapshot(const SnapshotView& lhs, const SnapshotView& rhs, float t, SnapshotFrame& out) {
+	interpolateSnapshots(&lhs, &rhs, &t, &out, 1);
+}
+
+
+
+/*************************************************************************************************************
+ Cubic Hermite kernel: locations follow the curve whose tangents are the recorded velocities, and
+ velocities are its derivative, so a ballistic arc is rebuilt exactly from its two ends.
+ dt is the signed time from lhs to rhs in seconds, negative when rewinding.
+ Angular velocities and boost are blended linearly, rotations by nlerp.
+**************************************************************************************************************/
+
+inline void interpolateSnapshotsCubic(const SnapshotView* lhs, const SnapshotView* rhs, const float* t, const float* dt, SnapshotFrame* out, size_t count) {
+	interpolateSnapshots(lhs, rhs, t, out, count);
+
+	for (size_t n = 0; n < count; n++) {
+		float t1 = t[n], t2 = t1 * t1, t3 = t2 * t1;
+		__m128 h00 = _mm_set1_ps(2 * t3 - 3 * t2 + 1);
+		__m128 h10 = _mm_set1_ps((t3 - 2 * t2 + t1) * dt[n]);
+		__m128 h01 = _mm_set1_ps(-2 * t3 + 3 * t2);
+		__m128 h11 = _mm_set1_ps((t3 - t2) * dt[n]);
+		// derivatives, divided by dt to get back to units per second
+		__m128 d00 = _mm_set1_ps((6 * t2 - 6 * t1) / dt[n]);
+		__m128 d10 = _mm_set1_ps(3 * t2 - 4 * t1 + 1);
+		__m128 d01 = _mm_set1_ps((-6 * t2 + 6 * t1) / dt[n]);
+		__m128 d11 = _mm_set1_ps(3 * t2 - 2 * t1);
+
+		for (int i = 0; i < SNAPSHOT_CHANNEL_WIDTH; i += 4) {
+			__m128 p0 = _mm_loadu_ps(lhs[n].location->v + i);
+			__m128 v0 = _mm_loadu_ps(lhs[n].velocity->v + i);
+			__m128 p1 = _mm_loadu_ps(rhs[n].location->v + i);
+			__m128 v1 = _mm_loadu_ps(rhs[n].velocity->v + i);
+
+			__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h00, p0), _mm_mul_ps(h10, v0)),
+				_mm_add_ps(_mm_mul_ps(h01, p1), _mm_mul_ps(h11, v1)));
+			__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d00, p0), _mm_mul_ps(d10, v0)),
+				_mm_add_ps(_mm_mul_ps(d01, p1), _mm_mul_ps(d11, v1)));
+
+			_mm_storeu_ps(out[n].location.v + i, p);
+			_mm_storeu_ps(out[n].velocity.v + i, v);
+		}
+	}
+}
+
+inline void interpolateSnapshotCubic(const SnapshotView& lhs, const SnapshotView& rhs, float t, float dt, SnapshotFrame& out) {
+	interpolateSnapshotsCubic(&lhs, &rhs, &t, &dt, &out, 1);
+}
@@ -0,0 +1,350 @@
+#pragma once
+#include "RingBuffer.h"
+#include "SnapshotFrame.h"
+#include "CompressedHistory.h"
+#include "SessionFile.h"
+#include "Timeline.h"
+#include "EventTrack.h"
+
+
+/*************************************************************************************************************
+ Uncompressed history stored channel by channel, each channel of each page in its own ring buffer, so
+ the history of every body is contiguous
+**************************************************************************************************************/
+
+class ColumnHistory
+{
+public:
+	ColumnHistory() : pages(1) {}
+
+	void setCapacity(size_t capacity) {
+		for (Page& page : pages) {
+			page.location.setCapacity(capacity);
+			page.velocity.setCapacity(capacity);
+			page.angularVelocity.setCapacity(capacity);
+			page.rotation.setCapacity(capacity);
+		}
+		timestamps.setCapacity(capacity);
+	}
+
+	/* clears the history if the number of pages changes */
+	void setPages(int count) {
+		if (count == pageCount()) return;
+		size_t kept = capacity();
+		clear();
+		pages.assign(count, Page());
+		setCapacity(kept);
+	}
+
+	int pageCount() const { return (int)pages.size(); }
+	size_t capacity() const { return timestamps.capacity(); }
+	size_t size() const { return timestamps.size(); }
+	bool empty() const { return timestamps.empty(); }
+
+	void clear() {
+		for (Page& page : pages) {
+			page.location.clear();
+			page.velocity.clear();
+			page.angularVelocity.clear();
+			page.rotation.clear();
+		}
+		timestamps.clear();
+	}
+
+	/* frames holds one frame per page */
+	void push_back(const SnapshotFrame* frames, float timestamp) {
+		for (size_t p = 0; p < pages.size(); p++) {
+			pages[p].location.push_back(frames[p].location);
+			pages[p].velocity.push_back(frames[p].velocity);
+			pages[p].angularVelocity.push_back(frames[p].angularVelocity);
+			pages[p].rotation.push_back(frames[p].rotation);
+		}
+		timestamps.push_back(timestamp);
+	}
+
+	SnapshotView view(size_t i, int page) const {
+		const Page& p = pages[page];
+		return SnapshotView{ &p.location.at(i), &p.velocity.at(i), &p.angularVelocity.at(i), &p.rotation.at(i) };
+	}
+
+	float& timestamp(size_t i) { return timestamps.at(i); }
+	float timestamp(size_t i) const { return timestamps.at(i); }
+
+private:
+	struct Page {
+		RingBuffer<SnapshotChannel> location;
+		RingBuffer<SnapshotChannel> velocity;
+		RingBuffer<SnapshotChannel> angularVelocity;
+		RingBuffer<SnapshotChannel> rotation;
+	};
+
+	std::vector<Page> pages;
+	RingBuffer<float> timestamps;
+};
+
+
+
+/*************************************************************************************************************
+ Rewind history, either uncompressed or compressed, sized by a memory budget
+
+ Snapshots are stored in recording order and never modified; a Timeline maps the positions of the
+ active branch onto them, so resuming from a rewound point forks a branch instead of appending after
+ the old future. The budget evicts the oldest snapshots whatever their branch.
+ It can also be attached to records of a session file, which are then read in place until the next
+ clear. Recording into an attached history first copies those records into its own storage.
+ Session records only hold the first page, so an attached history has a single page.
+ The car's jump state and the boost pads are kept as change events next to the snapshots, see EventTrack.
+**************************************************************************************************************/
+
+class SnapshotHistory
+{
+public:
+	SnapshotHistory() : compressed(false), budget(0), pages(1), balls(0), cars(0), pushed(0), attached(nullptr), attachedCount(0) {}
+
+	/* switching between compressed and uncompressed clears the history */
+	void configure(size_t budgetBytes, bool compress) {
+		if (compress != compressed) {
+			clear();
+			compressed = compress;
+		}
+		budget = budgetBytes;
+
+		if (compressed) packed.setBudget(budget);
+		else columns.setCapacity(budget / snapshotBytes());
+		timeline.setEvicted(pushed - stored());
+	}
+
+	/* the balls and cars recorded besides the ball and the car, changing them clears the history */
+	void setBodies(int otherBalls, int otherCars) {
+		if (otherBalls == balls && otherCars == cars) return;
+		detach();	// lets go of the session mapping, the records only have the pages of the old bodies
+		clear();
+		balls = otherBalls;
+		cars = otherCars;
+		pages = snapshotPages(balls + cars);
+		columns.setPages(pages);
+		packed.setPages(pages);
+		configure(budget, compressed);
+	}
+
+	int pageCount() const { return pages; }
+	int otherBalls() const { return balls; }
+	int otherCars() const { return cars; }
+
+	bool isCompressed() const { return compressed; }
+	size_t memoryUsage() const {
+		return (compressed ? packed.memoryUsage() : columns.capacity() * snapshotBytes()) + jumpEvents.memoryUsage() + padEvents.memoryUsage();
+	}
+
+	/* snapshots of the active branch */
+	size_t size() const { return timeline.size(); }
+	bool empty() const { return size() == 0; }
+
+	void clear() {
+		columns.clear();
+		packed.clear();
+		attached = nullptr;
+		attachedCount = 0;
+		pushed = 0;
+		timeline.clear();
+		jumpEvents.clear();
+		padEvents.clear();
+	}
+
+	/* the records must stay mapped until the history is cleared or detached */
+	void attach(SessionRecord* records, size_t count) {
+		setBodies(0, 0);
+		clear();
+		attached = records;
+		attachedCount = count;
+		for (pushed = 0; pushed < count; pushed++)
+			timeline.append(pushed, 0.0f);
+	}
+
+	bool isAttached() const { return attached != nullptr; }
+
+	/* copies the attached records into the history's own storage. Only the newest ones that can fit are
+	   copied, the older ones would be evicted by them anyway */
+	void detach() {
+		if (!attached) return;
+		SessionRecord* records = attached;
+		size_t count = attachedCount;
+		attached = nullptr;
+		attachedCount = 0;
+		size_t fitting = compressed ? packed.capacityBound() : columns.capacity();
+		for (size_t i = count > fitting ? count - fitting : 0; i < count; i++)
+			store(&records[i].frame, records[i].timestamp);
+		timeline.setEvicted(pushed - stored());
+	}
+
+	/* frames holds pageCount() frames, jump and pads are the car's jump state and the picked pads they were
+	   captured with */
+	void push_back(const SnapshotFrame* frames, float timestamp, const JumpState& jump, uint64_t pads) {
+		detach();
+		if (!timeline.canAppend(pushed))	// the active branch was left behind by another one, or evicted
+			timeline.fork(size(), timeline.forkGap());
+
+		float offset = 0.0f;
+		if (timeline.needsOffset() && !empty())
+			offset = this->timestamp(size() - 1) + timeline.forkGap() - timestamp;
+
+		store(frames, timestamp);
+		recordSideState(timestamp, offset, jump, pads);
+		timeline.append(pushed++, offset);
+		timeline.setEvicted(pushed - stored());
+		jumpEvents.trim(pushed - stored());
+		padEvents.trim(pushed - stored());
+	}
+
+	/* recording goes on from position at: a new branch is forked unless at is the end of the active one */
+	void resumeAt(size_t at, float gap) {
+		if (empty() || (at + 1 == size() && timeline.canAppend(pushed))) return;
+		timeline.fork(at < size() ? at + 1 : size(), gap);
+	}
+
+	const Timeline& branches() const { return timeline; }
+
+	/* switches to another branch, false (and no switch) if the budget evicted all of it */
+	bool selectBranch(int branch) {
+		int previous = timeline.activeBranch();
+		timeline.select(branch);
+		if (size() >= 2) return true;
+		timeline.select(previous);
+		return false;
+	}
+
+	/* position of the last snapshot at or before time, the first one if time is earlier. A binary search,
+	   the timestamps of a branch only grow */
+	size_t seek(float time) const {
+		size_t first = 0, count = size();
+		while (count > 0) {
+			size_t half = count / 2;
+			if (timestamp(first + half) <= time) {
+				first += half + 1;
+				count -= half + 1;
+			}
+			else count = half;
+		}
+		return first > 0 ? first - 1 : 0;
+	}
+
+	/* the car's jump state at position i, elapsed seconds later */
+	JumpState jumpAt(size_t i, float elapsed = 0.0f) const {
+		float offset;
+		const EventTrack<JumpState>::Event* e = jumpEvents.find(timeline.physical(i, offset));
+		if (!e) return JumpState();
+		JumpState state = e->value;
+		state.advance(timestamp(i) - offset - e->time + elapsed);
+		return state;
+	}
+
+	/* the boost pads at position i, elapsed seconds later */
+	PadState padsAt(size_t i, float elapsed = 0.0f) const {
+		float offset;
+		const EventTrack<PadState>::Event* e = padEvents.find(timeline.physical(i, offset));
+		if (!e) return PadState();
+		PadState state = e->value;
+		advance(state, timestamp(i) - offset - e->time + elapsed);
+		return state;
+	}
+
+	SnapshotView view(size_t i, int page = 0) const {
+		float offset;
+		uint64_t p = timeline.physical(i, offset);
+		if (attached) return SnapshotView::of(attached[p].frame);
+		size_t s = (size_t)(p - (pushed - stored()));
+		return compressed ? packed.view(s, page) : columns.view(s, page);
+	}
+
+	SnapshotFrame frame(size_t i, int page = 0) const {
+		SnapshotView v = view(i, page);
+		return SnapshotFrame{ *v.location, *v.velocity, *v.angularVelocity, *v.rotation };
+	}
+
+	float timestamp(size_t i) const {
+		float offset;
+		uint64_t p = timeline.physical(i, offset);
+		if (attached) return attached[p].timestamp + offset;
+		size_t s = (size_t)(p - (pushed - stored()));
+		return (compressed ? packed.timestamp(s) : columns.timestamp(s)) + offset;
+	}
+
+	/* blends the snapshots from and to, elapsed seconds after from, into pageCount() frames */
+	void interpolate(size_t from, size_t to, float elapsed, bool cubic, SnapshotFrame* out) const {
+		int count = pageCount();
+		SnapshotView lhs[SNAPSHOT_MAX_PAGES], rhs[SNAPSHOT_MAX_PAGES];
+		float ts[SNAPSHOT_MAX_PAGES], dts[SNAPSHOT_MAX_PAGES];
+
+		float dt = timestamp(to) - timestamp(from);
+		float t = fabsf(dt) < 0.0001f ? 0.0f : elapsed / fabsf(dt);
+		if (t > 1.0f) t = 1.0f;
+
+		for (int page = 0; page < count; page++) {
+			lhs[page] = view(from, page);
+			rhs[page] = view(to, page);
+			ts[page] = t;
+			dts[page] = dt;
+		}
+
+		if (cubic && fabsf(dt) >= 0.0001f) interpolateSnapshotsCubic(lhs, rhs, ts, dts, out, count);
+		else interpolateSnapshots(lhs, rhs, ts, out, count);
+	}
+
+private:
+	size_t snapshotBytes() const { return pages * sizeof(SnapshotFrame) + sizeof(float); }
+
+	/* snapshots held by the storage, every branch included */
+	size_t stored() const {
+		if (attached) return attachedCount;
+		return compressed ? packed.size() : columns.size();
+	}
+
+	void store(const SnapshotFrame* frames, float timestamp) {
+		if (compressed) packed.push_back(frames, timestamp);
+		else columns.push_back(frames, timestamp);
+	}
+
+	static void advance(PadState& state, float elapsed) {
+		for (int n = 0; n < PAD_MAX; n++)
+			if (state.picked & (1ull << n)) state.since[n] += elapsed;
+	}
+
+	/* an event for what changed since the last one, and for everything at the first snapshot of a branch,
+	   which goes on from the state at the fork */
+	void recordSideState(float timestamp, float offset, const JumpState& jump, uint64_t pads) {
+		bool first = timeline.startsBranch();
+
+		if (first || jumpEvents.empty() || !jump.follows(jumpEvents.back().value, timestamp - jumpEvents.back().time))
+			jumpEvents.record(pushed, timestamp, jump);
+
+		if (!first && !padEvents.empty() && padEvents.back().value.picked == pads) return;
+		PadState previous = PadState();
+		if (first && !empty())
+			previous = padsAt(size() - 1, timestamp + offset - this->timestamp(size() - 1));
+		else if (!first && !padEvents.empty()) {
+			previous = padEvents.back().value;
+			advance(previous, timestamp - padEvents.back().time);
+		}
+
+		PadState state = PadState();
+		state.known = true;
+		state.picked = pads;
+		for (int n = 0; n < PAD_MAX; n++)
+			if (pads & previous.picked & (1ull << n)) state.since[n] = previous.since[n];	// still down since then
+		padEvents.record(pushed, timestamp, state);
+	}
+
+	bool compressed;
+	size_t budget;
+	int pages;
+	int balls;
+	int cars;
+	ColumnHistory columns;
+	CompressedHistory packed;
+	Timeline timeline;
+	uint64_t pushed;			// snapshots stored since the clear, evicted ones included
+	SessionRecord* attached;	// copy-on-write pages of a session mapping
+	size_t attachedCount;
+	EventTrack<JumpState> jumpEvents;
+	EventTrack<PadState> padEvents;
+};
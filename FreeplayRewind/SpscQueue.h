@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+
+/*************************************************************************************************************
+ Bounded single-producer single-consumer queue
+
+ One thread pushes and one other thread pops, neither ever blocks or allocates. Capacity must be a
+ power of two, one slot is kept free to tell a full queue from an empty one.
+**************************************************************************************************************/
+
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	/* producer side, false if the queue is full */
+	bool push(const T& item) {
+		T* slot = claim();
+		if (!slot) return false;
+		*slot = item;
+		publish();
+		return true;
+	}
+
+	/* consumer side, false if the queue is empty */
+	bool pop(T& item) {
+		const T* slot = front();
+		if (!slot) return false;
+		item = *slot;
+		release();
+		return true;
+	}
+
+	/* producer side, the slot the next item goes to, filled in place then handed over by publish(). Null if
+	   the queue is full */
+	T* claim() {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (((t + 1) & (Capacity - 1)) == head.load(std::memory_order_acquire))
+			return nullptr;
+		return &items[t];
+	}
+
+	void publish() {
+		tail.store((tail.load(std::memory_order_relaxed) + 1) & (Capacity - 1), std::memory_order_release);
+	}
+
+	/* consumer side, the oldest item, read in place until release() frees its slot. Null if the queue is empty */
+	const T* front() const {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return nullptr;
+		return &items[h];
+	}
+
+	void release() {
+		head.store((head.load(std::memory_order_relaxed) + 1) & (Capacity - 1), std::memory_order_release);
+	}
+
+	/* approximate when called from a third thread */
+	size_t size() const {
+		return (tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)) & (Capacity - 1);
+	}
+
+	bool empty() const { return size() == 0; }
+
+private:
+	T items[Capacity];
+	alignas(64) std::atomic<size_t> head;	// next slot to pop, written by the consumer
+	alignas(64) std::atomic<size_t> tail;	// next slot to push, written by the producer
+};
@@ -0,0 +1,202 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ Branching timeline over an append-only snapshot store
+
+ A branch is a parent branch, the number of snapshots it shares with it (everything up to the fork) and
+ one contiguous run of its own snapshots in the store. Forking creates an empty branch, so it costs
+ nothing whatever the length of the history; the shared snapshots are never copied nor modified.
+ The snapshots of the active branch, from the root down, are cached as a few segments, positions are
+ counted from the oldest snapshot the store still holds. Timestamps of a forked branch are shifted so
+ its first snapshot follows the fork by the gap given to fork.
+ A branch whose own snapshots were all evicted is dropped unless it is the active one, its forks then
+ fork from its parent and the branches after it are renumbered.
+**************************************************************************************************************/
+
+class Timeline
+{
+public:
+	Timeline() { clear(); }
+
+	/* a single empty root branch */
+	void clear() {
+		branches.assign(1, Branch{ -1, 0, 0, 0, 0.0f, 0.0f });
+		active = 0;
+		evicted = 0;
+		rebuild();
+	}
+
+	size_t size() const { return (size_t)(length(active) - hidden); }
+	int activeBranch() const { return active; }
+	int branchCount() const { return (int)branches.size(); }
+	int parentOf(int branch) const { return branches[branch].parent; }
+	uint64_t forkOf(int branch) const { return branches[branch].shared; }
+	uint64_t lengthOf(int branch) const { return length(branch); }
+
+	/* store index (counted since the clear) of a position, and the offset to add to its timestamp */
+	uint64_t physical(size_t i, float& offset) const {
+		uint64_t position = i + hidden;
+		const Segment* s = &segments.back();
+		for (size_t n = segments.size(); n-- > 0;) {	// recent snapshots are the most read
+			if (position >= segments[n].logical) {
+				s = &segments[n];
+				break;
+			}
+		}
+		offset = s->offset;
+		return s->physical + (position - s->logical);
+	}
+
+	/* true if the store's next snapshot can extend the active branch */
+	bool canAppend(uint64_t next) const {
+		const Branch& b = branches[active];
+		return b.count == 0 || b.first + b.count == next;
+	}
+
+	/* the active branch only needs a time offset before its first snapshot */
+	bool needsOffset() const {
+		const Branch& b = branches[active];
+		return b.count == 0 && b.shared > 0;
+	}
+
+	float forkGap() const { return branches[active].gap; }
+
+	/* the next append is the active branch's first own snapshot */
+	bool startsBranch() const { return branches[active].count == 0; }
+
+	void append(uint64_t physical, float offset) {
+		Branch& b = branches[active];
+		if (b.count == 0) {
+			b.first = physical;
+			b.offset = offset;
+			b.count = 1;
+			rebuild();
+			return;
+		}
+		b.count++;
+		segments.back().count++;
+	}
+
+	/* a new branch sharing the first count positions, it becomes the active one. With count 0 it only
+	   shares what was evicted */
+	void fork(size_t count, float gap) {
+		uint64_t shared = count + hidden;
+		int owner = active;
+		for (const Segment& s : segments)
+			if (shared > s.logical && shared <= s.logical + s.count)
+				owner = s.branch;
+
+		branches.push_back(Branch{ owner, shared, 0, 0, 0.0f, gap });
+		active = (int)branches.size() - 1;
+		rebuild();
+	}
+
+	void select(int branch) {
+		active = branch;
+		rebuild();
+	}
+
+	/* the store dropped its oldest snapshots */
+	void setEvicted(uint64_t count) {
+		if (count == evicted) return;
+		evicted = count;
+		if (dropEvicted()) rebuild();
+		else updateHidden();
+	}
+
+	/* the branch the active one forked from and its other forks, in creation order */
+	std::vector<int> family() const {
+		int root = branches[active].parent < 0 ? active : branches[active].parent;
+		std::vector<int> members(1, root);
+		for (int i = 0; i < (int)branches.size(); i++)
+			if (branches[i].parent == root)
+				members.push_back(i);
+		return members;
+	}
+
+private:
+	struct Branch {
+		int parent;			// -1 for the root
+		uint64_t shared;	// positions shared with the parent
+		uint64_t first;		// store index of the first own snapshot
+		uint64_t count;		// own snapshots
+		float offset;		// added to the timestamps of the own snapshots
+		float gap;			// seconds between the fork and the first own snapshot
+	};
+
+	struct Segment {
+		uint64_t logical;	// position of the first snapshot, counted since the clear
+		uint64_t physical;	// its store index
+		uint64_t count;
+		float offset;
+		int branch;
+	};
+
+	uint64_t length(int branch) const { return branches[branch].shared + branches[branch].count; }
+
+	/* walks up from the active branch, each ancestor contributes what comes before the next fork */
+	void rebuild() {
+		segments.clear();
+		uint64_t limit = UINT64_MAX;
+		for (int b = active; b >= 0; b = branches[b].parent) {
+			const Branch& branch = branches[b];
+			uint64_t end = branch.shared + branch.count < limit ? branch.shared + branch.count : limit;
+			if (end > branch.shared)
+				segments.insert(segments.begin(), Segment{ branch.shared, branch.first, end - branch.shared, branch.offset, b });
+			if (branch.shared < limit) limit = branch.shared;
+		}
+		if (segments.empty())
+			segments.push_back(Segment{ 0, 0, 0, 0.0f, active });
+		updateHidden();
+	}
+
+	/* drops the branches all of whose own snapshots were evicted, but the active one. Their forks are
+	   moved to their parent: an ancestor's snapshots come before its forks' in the store, so only
+	   evicted positions lose their segment. True if any was dropped */
+	bool dropEvicted() {
+		std::vector<int> renumbered(branches.size());
+		bool dropped = false;
+		for (int b = 0; b < (int)branches.size(); b++) {
+			const Branch& branch = branches[b];
+			bool dead = b != active && branch.first + branch.count <= evicted;
+			renumbered[b] = dead ? -1 : b;
+			dropped = dropped || dead;
+		}
+		if (!dropped) return false;
+
+		int kept = 0;
+		for (int b = 0; b < (int)branches.size(); b++) {	// forks come after their parent
+			if (renumbered[b] < 0) continue;
+			Branch branch = branches[b];
+			int parent = branch.parent;
+			while (parent >= 0 && renumbered[parent] < 0)
+				parent = branches[parent].parent;
+			branch.parent = parent >= 0 ? renumbered[parent] : -1;
+			renumbered[b] = kept;
+			branches[kept++] = branch;
+		}
+		branches.resize(kept);
+		active = renumbered[active];
+		return true;
+	}
+
+	/* store indices grow with the positions, so the evicted snapshots are a prefix */
+	void updateHidden() {
+		hidden = length(active);
+		for (const Segment& s : segments) {
+			if (s.physical + s.count > evicted) {
+				hidden = s.logical + (evicted > s.physical ? evicted - s.physical : 0);
+				break;
+			}
+		}
+	}
+
+	std::vector<Branch> branches;
+	int active;
+	std::vector<Segment> segments;	// the active branch, oldest first
+	uint64_t evicted;				// snapshots dropped by the store since the clear
+	uint64_t hidden;				// positions of the active branch that were evicted
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+
+/*************************************************************************************************************
+ Lock-free triple buffer, one writer thread and one reader thread
+
+ The writer fills the back buffer and swaps it with the middle one, the reader swaps the middle buffer
+ with its front one when something new was published. Neither ever waits: the reader always sees the
+ last value published as a whole, values published in between are skipped.
+**************************************************************************************************************/
+
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1), back(2), front(0) {}
+
+	/* writer thread */
+	void publish(const T& value) {
+		buffers[back] = value;
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	/* reader thread, stays valid until its next read */
+	const T& read() {
+		if (middle.load(std::memory_order_relaxed) & FRESH)
+			front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return buffers[front];
+	}
+
+private:
+	static const uint8_t INDEX = 3;
+	static const uint8_t FRESH = 4;		// set while the middle buffer has not been read
+
+	T buffers[3];
+	alignas(64) std::atomic<uint8_t> middle;
+	alignas(64) uint8_t back;	// writer
+	alignas(64) uint8_t front;	// reader
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include "bakkesmod/wrappers/WrapperStructs.h"
+#include "SnapshotFrame.h"
+#include "EventTrack.h"
+#include "Quaternion.h"
+#include <vector>
+
+
+/*************************************************************************************************************
+ What the rewind engine needs from the game
+
+ RewindEngine and GameState only go through this interface, so the engine does not depend on the
+ BakkesMod wrappers: BakkesWorld is the game, the benchmark (see Bench) drives it with a simulated world.
+**************************************************************************************************************/
+
+struct BodyState {
+	Vector location;
+	Vector velocity;
+	Vector angularVelocity;
+	Quaternion rotation;
+	float boost;	// 0 for a ball
+};
+
+/* ball and car, indexed with SNAPSHOT_BALL and SNAPSHOT_CAR, then every other ball and car of the server */
+struct WorldState {
+	Vector location[SNAPSHOT_BODIES];
+	Vector velocity[SNAPSHOT_BODIES];
+	Vector angularVelocity[SNAPSHOT_BODIES];
+	Quaternion rotation[SNAPSHOT_BODIES];
+	float boost;
+	JumpState jump;		// of the car
+	PadState pads;		// capture only sets picked, the history knows since when
+	std::vector<BodyState> balls;
+	std::vector<BodyState> cars;
+};
+
+/* wrapper calls made by refresh, capture and apply, fr_stats */
+struct WorldCalls {
+	uint64_t reads = 0;
+	uint64_t writes = 0;
+	uint64_t skipped = 0;	// setters left out because the game already held the value
+};
+
+class RewindWorld
+{
+public:
+	virtual ~RewindWorld() {}
+
+	WorldCalls calls;
+
+	/* looks the ball, the car and the other bodies up for this tick, false if the ball or the car is missing */
+	virtual bool refresh() = 0;
+
+	/* balls and cars besides the ball and the car, as of the last refresh */
+	virtual int otherBodies() = 0;
+
+	virtual float secondsElapsed() = 0;
+	virtual bool isCarMoving() = 0;		// false right after a reset shot or a goal
+	virtual ControllerInput carInput() = 0;
+	virtual bool isBallInGoal() = 0;
+	virtual bool isKeyPressed(int key) = 0;
+	virtual bool isPaused() = 0;			// the pause menu is up, the game time stands still
+
+	/* sv_freeplay_enablegoal, only written when it changes */
+	virtual void setGoalEnabled(bool enabled) = 0;
+
+	virtual void capture(WorldState& state) = 0;
+	/* bodies missing from the state are left alone. Fields the game still holds as last applied may be skipped */
+	virtual void apply(const WorldState& state) = 0;
+};